@@ -0,0 +1,124 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * AnalogSampler.cpp : Implements the AnalogSampler class, which scans the analog inputs in background :
+ * the Timer0 overflow (the millis() timer, every 1.024 ms) starts a conversion of the next channel and
+ * the ADC interrupt filters the result (median of three, then exponential average), so the readings
+ * are ready at any time without waiting for the ADC. analogRead() must not be used after begin().
+ */
+
+#if defined(ARDUINO) && ARDUINO >= 100
+  #include <Arduino.h>
+#else
+  #include "WProgram.h"
+#endif
+
+#include "AnalogSampler.h"
+#include "settings.h"
+
+#if defined(__AVR__)
+// Sampler fed by the ADC interrupt
+static AnalogSampler *interruptSampler = NULL;
+
+ISR(ADC_vect)
+{
+  if(interruptSampler != NULL)
+    interruptSampler->conversionInterrupt();
+}
+#endif
+
+// Allows to store the pins in an array, in the order of the channels
+const uint8_t AnalogSampler::m_pins[ANALOG_CHANNELS] = {PIN_POT, PIN_PHOTOCELL, PIN_RAND};
+
+// Constructor
+AnalogSampler::AnalogSampler()
+{
+  m_channel = 0;
+  
+  for(int i = 0 ; i < ANALOG_CHANNELS ; i++)
+  {
+    m_newest[i] = 0;
+    m_filtered[i] = 0U;
+    
+    for(int j = 0 ; j < 3 ; j++)
+      m_history[i][j] = 0;
+  }
+}
+
+// Used to take a first reading of each input, then start the scan, from setup() (init() sets up the ADC after the constructors)
+void AnalogSampler::begin()
+{
+  for(int i = 0 ; i < ANALOG_CHANNELS ; i++)
+  {
+    int reading = analogRead(m_pins[i]);
+    
+    for(int j = 0 ; j < 3 ; j++)
+      m_history[i][j] = reading;
+    
+    m_filtered[i] = (unsigned int)reading << ANALOG_FILTER_SHIFT;
+  }
+  
+  #if defined(__AVR__)
+    interruptSampler = this;
+    m_channel = 0;
+    
+    // AVcc reference like analogRead(), conversion started by the Timer0 overflow, 125 kHz ADC clock
+    ADMUX = _BV(REFS0) | ((m_pins[0] >= A0 ? m_pins[0] - A0 : m_pins[0]) & 0x07);
+    ADCSRB = _BV(ADTS2);
+    ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADIF) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+  #endif
+}
+
+// Used to get the filtered reading of an input
+int AnalogSampler::getValue(byte channel)
+{
+  #if !defined(__AVR__)
+    // No ADC interrupt : a reading each time
+    addSample(channel, analogRead(m_pins[channel]));
+  #endif
+  
+  noInterrupts();
+  unsigned int filtered = m_filtered[channel];
+  interrupts();
+  
+  return (int)(filtered >> ANALOG_FILTER_SHIFT);
+}
+
+// Used to get the last reading of an input, without filtering (the noise of PIN_RAND for example)
+int AnalogSampler::getRaw(byte channel)
+{
+  noInterrupts();
+  int reading = m_history[channel][m_newest[channel]];
+  interrupts();
+  
+  return reading;
+}
+
+// Used to filter a new reading : the median of the last three drops the spikes, the average smoothes the rest
+void AnalogSampler::addSample(byte channel, int reading)
+{
+  volatile int *history = m_history[channel];
+  
+  m_newest[channel] = (m_newest[channel] + 1) % 3;
+  history[m_newest[channel]] = reading;
+  
+  int a = history[0], b = history[1], c = history[2];
+  int median = max(min(a, b), min(max(a, b), c));
+  
+  m_filtered[channel] = m_filtered[channel] - (m_filtered[channel] >> ANALOG_FILTER_SHIFT) + median;
+}
+
+// ADC interrupt : store the conversion, then select the channel converted at the next trigger
+void AnalogSampler::conversionInterrupt()
+{
+  #if defined(__AVR__)
+    addSample(m_channel, ADC);
+    
+    m_channel = (m_channel + 1) % ANALOG_CHANNELS;
+    ADMUX = (ADMUX & 0xF0) | ((m_pins[m_channel] >= A0 ? m_pins[m_channel] - A0 : m_pins[m_channel]) & 0x07);
+  #endif
+}
@@ -0,0 +1,44 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * AnalogSampler.h : AnalogSampler class definition.
+ */
+
+#ifndef DEF_ANALOGSAMPLER
+#define DEF_ANALOGSAMPLER
+
+#include "settings.h"
+
+#define ANALOG_CHANNELS 3
+#define ANALOG_FILTER_SHIFT 4 // Exponential average over about 2^4 samples (one sample per channel every 3 ms)
+
+// Lambda enumeration for the sampled inputs
+enum{ANALOG_POT = 0, ANALOG_PHOTOCELL = 1, ANALOG_RAND = 2};
+
+class AnalogSampler
+{
+  public:
+    AnalogSampler();
+    void begin();
+    int getValue(byte channel);
+    int getRaw(byte channel);
+  
+  private:
+    volatile int m_history[ANALOG_CHANNELS][3]; // Last three readings, for the median
+    volatile unsigned int m_filtered[ANALOG_CHANNELS]; // Average of the medians << ANALOG_FILTER_SHIFT
+    volatile byte m_newest[ANALOG_CHANNELS]; // Index of the last reading in the history
+    volatile byte m_channel; // Channel being converted
+    
+    void addSample(byte channel, int reading);
+    
+    static const uint8_t m_pins[ANALOG_CHANNELS];
+  
+  public:
+    void conversionInterrupt(); // Called by the ADC interrupt
+};
+
+#endif
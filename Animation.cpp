@@ -0,0 +1,144 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * Animation.cpp : Implements the Animation class, a non-blocking player calling a frame function at each deadline,
+ * or decoding the next frame of an encoded animation (see Animation.h) straight into the display buffer.
+ */
+
+#if defined(ARDUINO) && ARDUINO >= 100
+  #include <Arduino.h>
+#else
+  #include "WProgram.h"
+#endif
+
+#include "Animation.h"
+#include "Display.h"
+
+// Constructor
+Animation::Animation(Display *disp)
+{
+  m_disp = disp;
+  m_frame = NULL;
+  m_data = NULL;
+  m_frameIndex = 0;
+  m_nextFrameTime = 0UL;
+}
+
+// Used to play an animation from its first frame (the first frame is drawn by the next update())
+void Animation::start(AnimationFrame frame)
+{
+  m_frame = frame;
+  m_data = NULL;
+  m_frameIndex = 0;
+  m_nextFrameTime = millis();
+}
+
+// Used to play an encoded animation (the first frame is drawn by the next update()). Returns false if its frames
+// do not have the size of the display.
+boolean Animation::play(const byte *data)
+{
+  if(pgm_read_byte(data) != DISPLAY_WIDTH || pgm_read_byte(data + 1) != DISPLAY_HEIGHT)
+    return false;
+  
+  m_frame = NULL;
+  m_data = data + 2;
+  m_frameIndex = 0;
+  m_nextFrameTime = millis();
+  
+  return true;
+}
+
+// Used to stop the animation (the display buffer is left as is)
+void Animation::stop()
+{
+  m_frame = NULL;
+  m_data = NULL;
+}
+
+// Used to know if an animation is playing
+boolean Animation::isRunning()
+{
+  return m_frame != NULL || m_data != NULL;
+}
+
+// Used to draw the next frame when it is due. Returns true if the display buffer was modified.
+boolean Animation::update()
+{
+  if(!isRunning() || (long)(millis() - m_nextFrameTime) < 0) // Nothing to do yet
+    return false;
+  
+  int wait = (m_data != NULL) ? decodeFrame() : m_frame(m_disp, m_frameIndex++);
+  
+  if(wait < 0) // Last frame
+    stop();
+  else if(millis() - m_nextFrameTime > (unsigned long)wait) // Too late : do not try to catch up
+    m_nextFrameTime = millis() + wait;
+  else // Keep the frame rate steady
+    m_nextFrameTime += wait;
+  
+  return true;
+}
+
+// Used to draw the next frame of the encoded animation. Returns the time until the next one, -1 at the end.
+// A delta only costs its runs : the unchanged bytes are skipped.
+int Animation::decodeFrame()
+{
+  byte type = pgm_read_byte(m_data++);
+  
+  if(type != ANIMATION_KEYFRAME && type != ANIMATION_DELTA) // ANIMATION_END
+    return -1;
+  
+  int wait = pgm_read_byte(m_data) | (pgm_read_byte(m_data + 1) << 8);
+  m_data += 2;
+  
+  int i = 0;
+  
+  while(i < ANIMATION_FRAME_BYTES)
+  {
+    if(type == ANIMATION_KEYFRAME)
+    {
+      m_disp->drawByte(i % DISPLAY_BLOCKS_X, i / DISPLAY_BLOCKS_X, pgm_read_byte(m_data++));
+      i++;
+      continue;
+    }
+    
+    byte run = pgm_read_byte(m_data++);
+    int length = (run & ~ANIMATION_RUN_XOR) + 1;
+    
+    if(!(run & ANIMATION_RUN_XOR)) // Unchanged bytes
+    {
+      i += length;
+      continue;
+    }
+    
+    for(int j = 0 ; j < length && i < ANIMATION_FRAME_BYTES ; j++, i++)
+      m_disp->drawByte(i % DISPLAY_BLOCKS_X, i / DISPLAY_BLOCKS_X, pgm_read_byte(m_data++), BLIT_XOR);
+  }
+  
+  m_frameIndex++;
+  
+  return wait;
+}
+
+// ---------- Animations ----------
+
+// Boot sweep : a vertical and a horizontal line sweeping across the display, then a blank display
+int Animation::bootSweep(Display *disp, int frame)
+{
+  disp->clear();
+  
+  if(frame >= max(DISPLAY_WIDTH, DISPLAY_HEIGHT))
+    return -1;
+  
+  for(int i = 0 ; i < max(DISPLAY_WIDTH, DISPLAY_HEIGHT) ; i++)
+  {
+    disp->setLed(frame, i, true);
+    disp->setLed(i, frame, true);
+  }
+  
+  return 45;
+}
@@ -0,0 +1,64 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * Animation.h : Animation class definition.
+ */
+
+#ifndef DEF_ANIMATION
+#define DEF_ANIMATION
+
+#include "Display.h"
+
+/* ========== ENCODED ANIMATIONS ==========
+ *
+ * Stored in PROGMEM, made by sim/animconv from text frames :
+ *
+ * Byte 0 : Width of the frames (DISPLAY_WIDTH)
+ * Byte 1 : Height of the frames (DISPLAY_HEIGHT)
+ *
+ * Then each frame :
+ *   Byte 0 : Type (ANIMATION_KEYFRAME, ANIMATION_DELTA, or ANIMATION_END after the last frame)
+ *   Bytes 1-2 : Time until the next frame (ms, little endian, 32767 at most)
+ *   Keyframe : the ANIMATION_FRAME_BYTES bytes of the frame, rows from the top, 8 LEDs per byte (MSB = leftmost LED)
+ *   Delta : runs covering the ANIMATION_FRAME_BYTES bytes of the previous frame, each starting with a byte n :
+ *     n < 0x80 : the next n + 1 bytes are unchanged
+ *     n >= 0x80 : the next (n & 0x7F) + 1 bytes are XORed with the following (n & 0x7F) + 1 bytes
+ *
+ */
+
+#define ANIMATION_END 0x00
+#define ANIMATION_KEYFRAME 0x01
+#define ANIMATION_DELTA 0x02
+#define ANIMATION_RUN_XOR 0x80
+#define ANIMATION_FRAME_BYTES (DISPLAY_BLOCKS_X * DISPLAY_HEIGHT)
+
+// Draws frame #frame into the display buffer. Returns the time (ms) until the next frame, or -1 when finished.
+typedef int (*AnimationFrame)(Display *disp, int frame);
+
+class Animation
+{
+  public:
+    Animation(Display *disp);
+    void start(AnimationFrame frame);
+    boolean play(const byte *data);
+    void stop();
+    boolean isRunning();
+    boolean update();
+    
+    static int bootSweep(Display *disp, int frame);
+  
+  private:
+    Display *m_disp;
+    AnimationFrame m_frame;
+    const byte *m_data; // Next frame of the encoded animation being played (PROGMEM)
+    int m_frameIndex;
+    unsigned long m_nextFrameTime;
+    
+    int decodeFrame();
+};
+
+#endif
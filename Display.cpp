@@ -21,6 +21,17 @@
 
 #include <SPI.h>
 
+#if defined(__AVR__)
+// Display flushed in background, fed by the SPI interrupt
+static Display *backgroundDisplay = NULL;
+
+ISR(SPI_STC_vect)
+{
+  if(backgroundDisplay != NULL)
+    backgroundDisplay->spiTransferComplete();
+}
+#endif
+
 // Constructor
 Display::Display(InputHandler *inputs)
 {
@@ -32,22 +43,35 @@ Display::Display(InputHandler *inputs)
   pinMode(PIN_LOAD, OUTPUT);
   digitalWrite(PIN_LOAD, HIGH);
   
-  // Clear the buffer
-  clear();
-  
-  // Clear the backbuffer
-  for(int i = 0 ; i < 4 ; i++)
+  // Clear the buffer and the backbuffer, map the chain to the blocks
+  for(int i = 0 ; i < DISPLAY_DRIVERS ; i++)
   {
     for(int j = 0 ; j < 8 ; j++)
     {
+      m_buffer[i][j] = B00000000;
       m_backBuffer[i][j] = B00000000;
     }
+    
+    m_dirty[i] = B00000000;
+    m_chainBlock[i] = displayChainBlock(i);
   }
   
+  m_flushRegisters = 0;
+  m_flushBytes = 0;
+  m_totalBytes = 0UL;
+  
+  // Everything is sent synchronously until setBackgroundFlush() is called
+  m_backgroundFlush = false;
+  m_queueHead = 0;
+  m_queueWrite = 0;
+  m_queueTail = 0;
+  m_queueSentInTransaction = 0;
+  m_spiBusy = false;
+  
   // Setting-up the SPI library
   SPI.begin();
   SPI.setBitOrder(MSBFIRST);
-  SPI.setClockDivider(SPI_CLOCK_DIV128);
+  setSpiClock(DISPLAY_SPI_CLOCK);
   SPI.setDataMode(SPI_MODE0);
   
   // We do not want to use any decoding option
@@ -55,8 +79,8 @@ Display::Display(InputHandler *inputs)
   
   // Setting the brightness
   m_brightness = -1; // Auto mode
-  m_lastBrightnessUpdate = 0UL;
-  m_lastBrightnessValue = 0;
+  m_brightnessTarget = 0x08;
+  m_intensity = 0xFF;
   setBrightness(0x08);
   
   // Setting the scan limit to its maximal (we're using all outputs)
@@ -75,29 +99,107 @@ Display::Display(InputHandler *inputs)
   sendAll(MAX_REG_SHUTDOWN, 0x01);
 }
 
-// Seven segment digit table (GFEDCBA notation)
-const byte Display::m_sevenSegDigit[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
-const int Display::m_sevenSegTemplate[7][2][3] = 
-  {{{0, 1, 2}, {0, 0, 0}}, {{2, 2, 2}, {0, 1, 2}}, {{2, 2, 2}, {2, 3, 4}}, {{0, 1, 2}, {4, 4, 4}}, {{0, 0, 0}, {2, 3, 4}}, {{0, 0, 0}, {0, 1, 2}}, {{0, 1, 2}, {2, 2, 2}}};
+// SPI library clock settings, F_CPU / 2 to F_CPU / 128
+const byte Display::m_spiClockDividers[7] = {SPI_CLOCK_DIV2, SPI_CLOCK_DIV4, SPI_CLOCK_DIV8, SPI_CLOCK_DIV16, SPI_CLOCK_DIV32, SPI_CLOCK_DIV64, SPI_CLOCK_DIV128};
+
+// Photocell reading from which each intensity is used. The MAX7219 duty cycle of intensity n is (2n + 1) / 32 :
+// with a gamma of 2.2, the perceived brightness follows the reading, reaching the maximum at 900.
+const unsigned int Display::m_brightnessThresholds[16] PROGMEM = {0, 247, 347, 419, 478, 530, 576, 618, 656, 693, 727, 759, 790, 819, 847, 874};
+
+// Font glyphs, one byte per row (MSB = leftmost LED). The digits keep the seven segment look.
+const byte Display::m_font[FONT_LAST - FONT_FIRST + 1][FONT_HEIGHT] PROGMEM =
+{
+  {0x00, 0x00, 0x00, 0x00, 0x00}, // space
+  {0x40, 0x40, 0x40, 0x00, 0x40}, // !
+  {0xA0, 0xA0, 0x00, 0x00, 0x00}, // "
+  {0xA0, 0xE0, 0xA0, 0xE0, 0xA0}, // #
+  {0x60, 0xC0, 0x40, 0x60, 0xC0}, // $
+  {0x80, 0x20, 0x40, 0x80, 0x20}, // %
+  {0x40, 0xA0, 0x40, 0xA0, 0x60}, // &
+  {0x40, 0x40, 0x00, 0x00, 0x00}, // quote
+  {0x20, 0x40, 0x40, 0x40, 0x20}, // (
+  {0x80, 0x40, 0x40, 0x40, 0x80}, // )
+  {0x00, 0xA0, 0x40, 0xA0, 0x00}, // *
+  {0x00, 0x40, 0xE0, 0x40, 0x00}, // +
+  {0x00, 0x00, 0x00, 0x40, 0x80}, // ,
+  {0x00, 0x00, 0xE0, 0x00, 0x00}, // -
+  {0x00, 0x00, 0x00, 0x00, 0x40}, // .
+  {0x20, 0x20, 0x40, 0x80, 0x80}, // /
+  {0xE0, 0xA0, 0xA0, 0xA0, 0xE0}, // 0
+  {0x20, 0x20, 0x20, 0x20, 0x20}, // 1
+  {0xE0, 0x20, 0xE0, 0x80, 0xE0}, // 2
+  {0xE0, 0x20, 0xE0, 0x20, 0xE0}, // 3
+  {0xA0, 0xA0, 0xE0, 0x20, 0x20}, // 4
+  {0xE0, 0x80, 0xE0, 0x20, 0xE0}, // 5
+  {0xE0, 0x80, 0xE0, 0xA0, 0xE0}, // 6
+  {0xE0, 0x20, 0x20, 0x20, 0x20}, // 7
+  {0xE0, 0xA0, 0xE0, 0xA0, 0xE0}, // 8
+  {0xE0, 0xA0, 0xE0, 0x20, 0xE0}, // 9
+  {0x00, 0x40, 0x00, 0x40, 0x00}, // :
+  {0x00, 0x40, 0x00, 0x40, 0x80}, // ;
+  {0x20, 0x40, 0x80, 0x40, 0x20}, // <
+  {0x00, 0xE0, 0x00, 0xE0, 0x00}, // =
+  {0x80, 0x40, 0x20, 0x40, 0x80}, // >
+  {0xE0, 0x20, 0x40, 0x00, 0x40}, // ?
+  {0xE0, 0xA0, 0xA0, 0x80, 0xE0}, // @
+  {0x40, 0xA0, 0xE0, 0xA0, 0xA0}, // A
+  {0xC0, 0xA0, 0xC0, 0xA0, 0xC0}, // B
+  {0xE0, 0x80, 0x80, 0x80, 0xE0}, // C
+  {0xC0, 0xA0, 0xA0, 0xA0, 0xC0}, // D
+  {0xE0, 0x80, 0xC0, 0x80, 0xE0}, // E
+  {0xE0, 0x80, 0xC0, 0x80, 0x80}, // F
+  {0xE0, 0x80, 0xA0, 0xA0, 0xE0}, // G
+  {0xA0, 0xA0, 0xE0, 0xA0, 0xA0}, // H
+  {0xE0, 0x40, 0x40, 0x40, 0xE0}, // I
+  {0x20, 0x20, 0x20, 0xA0, 0xE0}, // J
+  {0xA0, 0xA0, 0xC0, 0xA0, 0xA0}, // K
+  {0x80, 0x80, 0x80, 0x80, 0xE0}, // L
+  {0xA0, 0xE0, 0xE0, 0xA0, 0xA0}, // M
+  {0xC0, 0xA0, 0xA0, 0xA0, 0xA0}, // N
+  {0xE0, 0xA0, 0xA0, 0xA0, 0xE0}, // O
+  {0xE0, 0xA0, 0xE0, 0x80, 0x80}, // P
+  {0xE0, 0xA0, 0xA0, 0xE0, 0x20}, // Q
+  {0xC0, 0xA0, 0xC0, 0xA0, 0xA0}, // R
+  {0xE0, 0x80, 0xE0, 0x20, 0xE0}, // S
+  {0xE0, 0x40, 0x40, 0x40, 0x40}, // T
+  {0xA0, 0xA0, 0xA0, 0xA0, 0xE0}, // U
+  {0xA0, 0xA0, 0xA0, 0xA0, 0x40}, // V
+  {0xA0, 0xA0, 0xE0, 0xE0, 0xA0}, // W
+  {0xA0, 0xA0, 0x40, 0xA0, 0xA0}, // X
+  {0xA0, 0xA0, 0x40, 0x40, 0x40}, // Y
+  {0xE0, 0x20, 0x40, 0x80, 0xE0}, // Z
+  {0xC0, 0x80, 0x80, 0x80, 0xC0}, // [
+  {0x80, 0x80, 0x40, 0x20, 0x20}, // backslash
+  {0x60, 0x20, 0x20, 0x20, 0x60}, // ]
+  {0x40, 0xA0, 0x00, 0x00, 0x00}, // ^
+  {0x00, 0x00, 0x00, 0x00, 0xE0}, // _
+  {0xE0, 0xA0, 0xE0, 0x00, 0x00} // degree
+};
 
 // Send the same command to each driver
 void Display::sendAll(byte reg, byte val)
 {
-  digitalWrite(PIN_LOAD, LOW);
+  beginTransaction();
   
-  for(int i = 0 ; i < 4 ; i++)
+  for(int i = 0 ; i < DISPLAY_DRIVERS ; i++)
   {
-    SPI.transfer(reg);
-    SPI.transfer(val);
+    sendByte(reg);
+    sendByte(val);
   }
   
-  digitalWrite(PIN_LOAD, HIGH);
+  endTransaction();
+  
+  m_totalBytes += DISPLAY_DRIVERS * 2;
 }
 
-// Used to modify the brightness of the display
+// Used to modify the brightness of the display, only sent if it changes
 void Display::setBrightness(byte val)
 {
+  if(val == m_intensity)
+    return;
+  
   sendAll(MAX_REG_INTENSITY, val);
+  m_intensity = val;
 }
 
 // Used to test the display
@@ -112,45 +214,62 @@ void Display::setTestMode(boolean testMode)
 // Used to clear the buffer
 void Display::clear()
 {
-  for(int i = 0 ; i < 4 ; i++)
+  for(int i = 0 ; i < DISPLAY_DRIVERS ; i++)
   {
     for(int j = 0 ; j < 8 ; j++)
     {
+      if(m_buffer[i][j] != B00000000)
+      {
         m_buffer[i][j] = B00000000;
+        m_dirty[i] |= B00000001 << j;
+      }
     }
   }
 }
 
 // Used to send the content of the buffer to the controllers
+// Only the registers flagged in m_dirty are looked at, so the cost is proportional to what changed.
+// In background mode, the values are copied into the queue before returning : what is drawn afterwards is not
+// sent before the next call, so each flush shows the buffer as it was when display() was called.
 void Display::display()
 {
-  int modifiedRegAmount[4] = {0};
   int maxModifiedRegAmount = 0;
-  int lastDigitUpdated[4] = {0}; // Stores the last digit updated
   
-  // Find the modified registers for each driver
-  for(int i = 0 ; i < 4 ; i++)
+  m_flushRegisters = 0;
+  m_flushBytes = 0;
+  
+  // Drop the dirty registers that went back to their displayed value, and count the others
+  for(int i = 0 ; i < DISPLAY_DRIVERS ; i++)
   {
-    for(int j = 0 ; j < 8 ; j++)
+    byte dirty = m_dirty[i];
+    int modifiedRegAmount = 0;
+    
+    for(int j = 0 ; dirty != 0 ; j++, dirty >>= 1)
     {
-      if(m_buffer[i][j] != m_backBuffer[i][j])
-        modifiedRegAmount[i]++;
+      if(!(dirty & B00000001))
+        continue;
+      
+      if(m_buffer[i][j] == m_backBuffer[i][j])
+        m_dirty[i] &= ~(B00000001 << j);
+      else
+        modifiedRegAmount++;
     }
     
-    maxModifiedRegAmount = max(modifiedRegAmount[i], maxModifiedRegAmount);
+    m_flushRegisters += modifiedRegAmount;
+    maxModifiedRegAmount = max(modifiedRegAmount, maxModifiedRegAmount);
   }
   
   #ifdef SERIAL_DEBUG
     Serial.println("==== Sending " + String(maxModifiedRegAmount) + " commands ====");
     Serial.println("--- Modified registers ---");
     
-    for(int i = 0 ; i < 4 ; i++)
+    for(int i = 0 ; i < DISPLAY_DRIVERS ; i++)
     {
       Serial.println("Driver #" + String(i));
       
       for(int j = 0 ; j < 8 ; j++)
       {
-        if(m_buffer[i][j] != m_backBuffer[i][j])
+        if(m_dirty[i] & (B00000001 << j))
           Serial.println("  DIG" + String(j) + " : YES");
         else
           Serial.println("  DIG" + String(j) + " : NO");
@@ -168,29 +287,29 @@ void Display::display()
        Serial.println("--- Sending #" + String(i) + " ---");
     #endif
       
-    digitalWrite(PIN_LOAD, LOW);
-    for(int j = 3 ; j >= 0 ; j--) // We have to send the commands in reverse order
+    beginTransaction();
+    for(int pos = DISPLAY_DRIVERS - 1 ; pos >= 0 ; pos--) // We have to send the commands in reverse order
     { 
-      // Find the digit to update
-      int k = lastDigitUpdated[j];
-      while(m_buffer[j][k] == m_backBuffer[j][k] && k < 8)
-      {
-        k++;
-      }
+      int j = m_chainBlock[pos];
       
       // Update it
-      if(k == 8) // We have updated all the registers ; send no-op code
+      if(m_dirty[j] == 0) // We have updated all the registers ; send no-op code
       {
         #ifdef SERIAL_DEBUG
           Serial.println("Driver #" + String(j) + " : No operation");
         #endif
       
-        SPI.transfer(MAX_REG_NOOP);
-        SPI.transfer(MAX_REG_NOOP);
+        sendByte(MAX_REG_NOOP);
+        sendByte(MAX_REG_NOOP);
       }
       else // We do not have updated all registers
       {
-        lastDigitUpdated[j] = k; // Save the last digit updated
+        // Take the lowest dirty digit
+        int k = 0;
+        while(!(m_dirty[j] & (B00000001 << k)))
+          k++;
+        
+        m_dirty[j] &= ~(B00000001 << k);
         m_backBuffer[j][k] = m_buffer[j][k]; // Copy the buffer into the backbuffer
         
         #ifdef SERIAL_DEBUG
@@ -199,88 +318,368 @@ void Display::display()
         #endif
         
         // Send command
-        SPI.transfer(k + 1); // Register (DIG0 = REG #1, DIG1 = REG #2, ..., DIG 7 = REG #8)
-        SPI.transfer(m_buffer[j][k]); // Value
+        sendByte(k + 1); // Register (DIG0 = REG #1, DIG1 = REG #2, ..., DIG 7 = REG #8)
+        sendByte(m_buffer[j][k]); // Value
       }
     }
-    digitalWrite(PIN_LOAD, HIGH); // Load da shit
+    endTransaction(); // Load da shit
+  }
+  
+  m_flushBytes = maxModifiedRegAmount * DISPLAY_DRIVERS * 2;
+  m_totalBytes += m_flushBytes;
+}
+
+// Used to switch between synchronous flushes (display() returns once everything is sent) and
+// background flushes (display() queues the register writes, the SPI interrupt sends them)
+void Display::setBackgroundFlush(boolean enabled)
+{
+  waitFlush();
+  
+  m_backgroundFlush = enabled;
+  
+  #if defined(__AVR__)
+    if(enabled)
+    {
+      backgroundDisplay = this;
+      SPI.attachInterrupt();
+    }
+    else
+      SPI.detachInterrupt();
+  #endif
+}
+
+// Used to set the SPI clock : the fastest F_CPU / 2^n that is neither above the requested
+// clock nor above what the MAX7219 accepts (or F_CPU / 128 if none is). Returns the clock used.
+unsigned long Display::setSpiClock(unsigned long clock)
+{
+  int i = 0;
+  
+  clock = min(clock, MAX7219_MAX_CLOCK);
+  
+  while(i < 6 && (F_CPU >> (i + 1)) > clock)
+    i++;
+  
+  waitFlush(); // Do not change the clock in the middle of a byte
+  SPI.setClockDivider(m_spiClockDividers[i]);
+  m_spiClock = F_CPU >> (i + 1);
+  
+  return m_spiClock;
+}
+
+// Used to get the SPI clock in Hz
+unsigned long Display::getSpiClock()
+{
+  return m_spiClock;
+}
+
+// Used to know if queued register writes are still being sent
+boolean Display::isBusy()
+{
+  return m_spiBusy;
+}
+
+// Used to wait for the end of the background flush
+void Display::waitFlush()
+{
+  while(isBusy())
+    ;
+}
+
+// Used to start a chain transaction (one command per driver)
+void Display::beginTransaction()
+{
+  if(!m_backgroundFlush)
+    digitalWrite(PIN_LOAD, LOW);
+}
+
+// Used to send a byte of the current transaction, or to queue it in background mode
+void Display::sendByte(byte val)
+{
+  if(!m_backgroundFlush)
+  {
+    SPI.transfer(val);
+    return;
+  }
+  
+  unsigned int next = (m_queueWrite + 1 == DISPLAY_QUEUE_SIZE) ? 0 : m_queueWrite + 1;
+  unsigned int tail;
+  
+  do // Wait for some room if we are more than a frame ahead
+  {
+    noInterrupts();
+    tail = m_queueTail;
+    interrupts();
+  } while(next == tail);
+  
+  m_queue[m_queueWrite] = val;
+  m_queueWrite = next;
+}
+
+// Used to latch the current transaction, or to hand it over to the SPI interrupt in background mode
+void Display::endTransaction()
+{
+  if(!m_backgroundFlush)
+  {
+    digitalWrite(PIN_LOAD, HIGH);
+    return;
+  }
+  
+  // Only whole transactions are made visible to the interrupt
+  noInterrupts();
+  m_queueHead = m_queueWrite;
+  interrupts();
+  
+  startBackgroundTransfer();
+}
+
+// Used to send the first queued byte if the SPI is idle
+void Display::startBackgroundTransfer()
+{
+  noInterrupts();
+  
+  if(m_spiBusy || m_queueTail == m_queueHead)
+  {
+    interrupts();
+    return;
+  }
+  
+  m_spiBusy = true;
+  digitalWrite(PIN_LOAD, LOW);
+  
+  #if defined(__AVR__)
+    SPDR = m_queue[m_queueTail]; // spiTransferComplete() will follow from the interrupt
+    interrupts();
+  #else
+    // No SPI interrupt on this target : run the same state machine synchronously
+    interrupts();
+    
+    while(m_spiBusy)
+    {
+      SPI.transfer(m_queue[m_queueTail]);
+      spiTransferComplete();
+    }
+  #endif
+}
+
+// Called each time a queued byte has been shifted out : latch the chain after a whole
+// transaction and go on with the next byte
+void Display::spiTransferComplete()
+{
+  unsigned int tail = (m_queueTail + 1 == DISPLAY_QUEUE_SIZE) ? 0 : m_queueTail + 1;
+  
+  m_queueTail = tail;
+  
+  if(++m_queueSentInTransaction == DISPLAY_DRIVERS * 2) // Every driver has its command
+  {
+    m_queueSentInTransaction = 0;
+    digitalWrite(PIN_LOAD, HIGH);
+  }
+  
+  if(tail == m_queueHead) // Queue empty
+  {
+    m_spiBusy = false;
+    return;
   }
+  
+  if(m_queueSentInTransaction == 0)
+    digitalWrite(PIN_LOAD, LOW);
+  
+  #if defined(__AVR__)
+    SPDR = m_queue[tail];
+  #endif
 }
 
-// Used to set an led in the buffer
+// Used to set an led in the buffer (LEDs outside of the panel are ignored)
 void Display::setLed(int x, int y, boolean val)
 {
-  // Find position
-  int driver = (x / 8) + ((y / 8) * 2); // x_d = x/8 | y_d = y/8 || i_d = x_d + y_d * 2
-  int dig = y % 8;
-  int seg = 7 - (x % 8); // DP = 7, A = 6, ... , G = 0
+  if((unsigned int)x >= DISPLAY_WIDTH || (unsigned int)y >= DISPLAY_HEIGHT)
+    return;
   
-  // Backup the digit (one byte/register)
-  byte oldVal = m_buffer[driver][dig];
+  // Find position (shifts only : the block width is a power of two)
+  byte *digit = &m_buffer[(y >> 3) * DISPLAY_BLOCKS_X + (x >> 3)][y & 7];
+  byte mask = B10000000 >> (x & 7); // DP = 7, A = 6, ... , G = 0
   
   // Update buffer
-  if(val) // Turn it on
-    m_buffer[driver][dig] |= B00000001 << seg;
-  else // Turn it off
-    m_buffer[driver][dig] &= ~(B00000001 << seg);
+  if(val && !(*digit & mask)) // Turn it on
+  {
+    *digit |= mask;
+    m_dirty[(y >> 3) * DISPLAY_BLOCKS_X + (x >> 3)] |= B00000001 << (y & 7);
+  }
+  else if(!val && (*digit & mask)) // Turn it off
+  {
+    *digit &= ~mask;
+    m_dirty[(y >> 3) * DISPLAY_BLOCKS_X + (x >> 3)] |= B00000001 << (y & 7);
+  }
 }
 
-// Used to check the state of an led in the buffer
+// Used to check the state of an led in the buffer (LEDs outside of the panel are off)
 boolean Display::testLed(int x, int y)
 {
-  // Find position
-  int driver = (x / 8) + ((y / 8) * 2); // x_d = x/8 | y_d = y/8 || i_d = x_d + y_d * 2
-  int dig = y % 8;
-  int seg = 7 - (x % 8); // DP = 7, A = 6, ... , G = 0
+  if((unsigned int)x >= DISPLAY_WIDTH || (unsigned int)y >= DISPLAY_HEIGHT)
+    return false;
   
   // Check the buffer
-  return (m_buffer[driver][dig] & (B00000001 << seg)) ? true : false;
+  return (m_buffer[(y >> 3) * DISPLAY_BLOCKS_X + (x >> 3)][y & 7] & (B10000000 >> (x & 7))) ? true : false;
 }
 
-// Used to display a seven segment digit
-void Display::setDigit(int x, int y, int digit)
+// Used to get a whole row of the buffer (most significant bit = x 0)
+DisplayRow Display::getRow(int y)
+{
+  int block = (y >> 3) * DISPLAY_BLOCKS_X;
+  int dig = y & 7;
+  DisplayRow row = 0;
+  
+  for(int i = 0 ; i < DISPLAY_BLOCKS_X ; i++)
+    row = (row << 8) | m_buffer[block + i][dig];
+  
+  return row;
+}
+
+// Used to set a whole row of the buffer (most significant bit = x 0)
+void Display::setRow(int y, DisplayRow row)
 {
-  // Clear the digit area
-  for(int i = 0 ; i < 3 ; i++)
+  int block = (y >> 3) * DISPLAY_BLOCKS_X;
+  int dig = y & 7;
+  
+  for(int i = DISPLAY_BLOCKS_X - 1 ; i >= 0 ; i--)
   {
-    for(int j = 0 ; j < 5 ; j++)
+    if(m_buffer[block + i][dig] != (byte)row)
     {
-      setLed(x + i, y + j, false);
+      m_buffer[block + i][dig] = (byte)row;
+      m_dirty[block + i] |= B00000001 << dig;
     }
+    
+    row >>= 8;
   }
+}
+
+// Used to display a seven segment digit
+void Display::setDigit(int x, int y, int digit)
+{
+  drawGlyph(x, y, '0' + digit, BLIT_COPY);
+}
+
+// Used to draw a bitmap stored in flash (one byte per row, MSB = leftmost LED, up to 8 LEDs wide).
+// Each row is shifted onto the one or two block bytes it covers, LEDs outside of the panel are clipped.
+void Display::blit(int x, int y, const byte *bitmap, byte width, byte height, byte mode)
+{
+  byte area = (byte)(0xFF00 >> min(width, (byte)8)); // Columns covered by the bitmap
+  int column = (x - (x & 7)) / 8; // Rounded down, x can be negative
+  byte shift = x & 7;
   
-  // Insert the digit into the buffer
-  for(int i = 0 ; i < 7 ; i++)
+  for(byte i = 0 ; i < height ; i++)
   {
-    if(m_sevenSegDigit[digit] & (B00000001 << i))
-    {
-      for(int j = 0 ; j < 3; j++)
-        setLed(x + m_sevenSegTemplate[i][0][j], y + m_sevenSegTemplate[i][1][j], true);
-    }
+    if((unsigned int)(y + i) >= DISPLAY_HEIGHT)
+      continue;
+    
+    byte bits = pgm_read_byte(bitmap + i) & area;
+    
+    blitByte(column, y + i, bits >> shift, area >> shift, mode);
+    
+    if(shift != 0) // Straddling two blocks
+      blitByte(column + 1, y + i, (byte)(bits << (8 - shift)), (byte)(area << (8 - shift)), mode);
+  }
+}
+
+// Used to combine the bits of one block row with the buffer
+void Display::blitByte(int column, int y, byte bits, byte mask, byte mode)
+{
+  if((unsigned int)column >= DISPLAY_BLOCKS_X || mask == 0)
+    return;
+  
+  int block = (y >> 3) * DISPLAY_BLOCKS_X + column;
+  byte *digit = &m_buffer[block][y & 7];
+  byte val;
+  
+  if(mode == BLIT_OR)
+    val = *digit | bits;
+  else if(mode == BLIT_AND)
+    val = *digit & (bits | ~mask);
+  else if(mode == BLIT_XOR)
+    val = *digit ^ bits;
+  else // BLIT_COPY
+    val = (*digit & ~mask) | bits;
+  
+  if(val != *digit)
+  {
+    *digit = val;
+    m_dirty[block] |= B00000001 << (y & 7);
+  }
+}
+
+// Used to draw 8 LEDs at once, at a multiple of 8 (column of blocks) : MSB = leftmost LED
+void Display::drawByte(int column, int y, byte bits, byte mode)
+{
+  if((unsigned int)y < DISPLAY_HEIGHT)
+    blitByte(column, y, bits, 0xFF, mode);
+}
+
+// Used to find the glyph of a character (unknown characters are drawn as '?')
+const byte *Display::getGlyph(char c)
+{
+  if(c >= 'a' && c <= 'z')
+    c -= 'a' - 'A';
+  
+  if(c < FONT_FIRST || c > FONT_LAST)
+    c = '?';
+  
+  return m_font[c - FONT_FIRST];
+}
+
+// Used to draw a character of the font
+void Display::drawGlyph(int x, int y, char c, byte mode)
+{
+  blit(x, y, getGlyph(c), FONT_WIDTH, FONT_HEIGHT, mode);
+}
+
+// Used to draw a string, one blank column between the characters. Returns the x following the text.
+int Display::drawText(int x, int y, const char *text, byte mode)
+{
+  for( ; *text != '\0' ; text++)
+  {
+    // The blank column is part of the cell, so that BLIT_COPY clears it
+    blit(x, y, getGlyph(*text), FONT_WIDTH + 1, FONT_HEIGHT, mode);
+    x += FONT_WIDTH + 1;
   }
+  
+  return x;
+}
+
+// Used to find one row of a glyph (MSB = leftmost LED)
+byte Display::getGlyphRow(char c, int row)
+{
+  return pgm_read_byte(getGlyph(c) + row);
 }
 
-// Used to display a test pattern
-void Display::testPattern()
+// Used to shift a band of rows one LED to the left, the rightmost column being cleared
+void Display::scrollLeft(int y, int height)
 {
-  for(int i = 0 ; i < 16 ; i++)
+  for(int j = max(y, 0) ; j < min(y + height, DISPLAY_HEIGHT) ; j++)
   {
-    clear();
-    for(int j = 0 ; j < 16 ; j++)
+    int block = (j >> 3) * DISPLAY_BLOCKS_X;
+    int dig = j & 7;
+    byte carry = 0; // Leftmost LED of the block on the right
+    
+    for(int i = DISPLAY_BLOCKS_X - 1 ; i >= 0 ; i--)
     {
-      setLed(i, j, true);
-      setLed(j, i, true);
+      byte val = m_buffer[block + i][dig];
+      byte shifted = (val << 1) | carry;
+      
+      carry = val >> 7;
+      
+      if(shifted != val)
+      {
+        m_buffer[block + i][dig] = shifted;
+        m_dirty[block + i] |= B00000001 << dig;
+      }
     }
-    display();
-    delay(45);
   }
-  clear();
 }
 
 // Used to know if no LED is no
 boolean Display::empty()
 {
-  for(int i = 0 ; i < 4 ; i++)
+  for(int i = 0 ; i < DISPLAY_DRIVERS ; i++)
   {
     for(int j = 0 ; j < 8 ; j++)
     {
@@ -292,6 +691,24 @@ boolean Display::empty()
   return true;
 }
 
+// Used to get the number of registers updated by the last display() call
+unsigned int Display::getFlushRegisters()
+{
+  return m_flushRegisters;
+}
+
+// Used to get the number of SPI bytes (no-ops included) sent by the last display() call
+unsigned int Display::getFlushBytes()
+{
+  return m_flushBytes;
+}
+
+// Used to get the number of SPI bytes sent since power-up
+unsigned long Display::getTotalBytes()
+{
+  return m_totalBytes;
+}
+
 // Used to adjust the brightness. Returns : 0 : display buffer not modified, 1 : display buffer modified, 2 : adjusting time finished
 int Display::adjustBrightness()
 {
@@ -360,16 +777,24 @@ int Display::adjustBrightness()
   return 0;
 }
 
-// Used to updadte the brightness
-void Display::updateBrightness()
+// Used to updadte the brightness from the photocell reading (to be called every BRIGHTNESS_UPDATE_INTERVAL) :
+// the target level only moves once the reading is BRIGHTNESS_HYSTERESIS past a threshold, and the intensity
+// ramps to it one level per update
+void Display::updateBrightness(int light)
 {
-  int reading = analogRead(PIN_PHOTOCELL);
+  if(m_brightness != -1) // Not in auto mode
+    return;
   
-  if(m_brightness == -1 && millis() - m_lastBrightnessUpdate >= BRIGHTNESS_UPDATE_INTERVAL && abs(reading - m_lastBrightnessValue) > BRIGHTNESS_UPDATE_THRESHOLD)
-  {
-    setBrightness((byte)constrain(map(reading, 0, 900, 0x00, 0x0F), 0x00, 0x0F));
-    m_lastBrightnessValue = reading;
-  }
+  while(m_brightnessTarget < 0x0F && light >= (int)pgm_read_word(&m_brightnessThresholds[m_brightnessTarget + 1]) + BRIGHTNESS_HYSTERESIS)
+    m_brightnessTarget++;
+  
+  while(m_brightnessTarget > 0x00 && light < (int)pgm_read_word(&m_brightnessThresholds[m_brightnessTarget]) - BRIGHTNESS_HYSTERESIS)
+    m_brightnessTarget--;
+  
+  if(m_intensity < m_brightnessTarget)
+    setBrightness(m_intensity + 1);
+  else if(m_intensity > m_brightnessTarget)
+    setBrightness(m_intensity - 1);
 }
 
 // ---------- Debuging functions ---------------
@@ -378,52 +803,22 @@ void Display::updateBrightness()
 #ifdef DEBUG
 void Display::printBuffer()
 {
-  // Print drivers 0 and 1
-  for(int i = 0 ; i < 8 ; i++)
+  for(int y = 0 ; y < DISPLAY_HEIGHT ; y++)
   {
-    // Print driver 0
-    for(int j = 7 ; j >= 0 ; j--)
+    if(y != 0 && y % 8 == 0) // Horizontal separation between drivers
     {
-      if(m_buffer[0][i] & (B00000001 << j)) // Led is on
-        Serial.print("X ");
-      else // Led is off
-        Serial.print(". ");
-    }
-    
-    Serial.print("+ ");
-    
-    // Print driver 1
-    for(int j = 7 ; j >= 0 ; j--)
-    {
-      if(m_buffer[1][i] & (B00000001 << j)) // Led is on
-        Serial.print("X ");
-      else // Led is off
-        Serial.print(". ");
-    }
-    
-    Serial.print("\n"); // Line is finished
-  }
-  
-  Serial.println("+ + + + + + + + + + + + + + + + + ");
-  
-  // Print drivers 2 and 3
-  for(int i = 0 ; i < 8 ; i++)
-  {
-    // Print driver 2
-    for(int j = 7 ; j >= 0 ; j--)
-    {
-      if(m_buffer[2][i] & (B00000001 << j)) // Led is on
-        Serial.print("X ");
-      else // Led is off
-        Serial.print(". ");
+      for(int x = 0 ; x < DISPLAY_WIDTH + DISPLAY_BLOCKS_X ; x++)
+        Serial.print("+ ");
+      
+      Serial.print("\n");
     }
     
-    Serial.print("+ ");
-    
-    // Print driver 3
-    for(int j = 7 ; j >= 0 ; j--)
+    for(int x = 0 ; x < DISPLAY_WIDTH ; x++)
     {
-      if(m_buffer[3][i] & (B00000001 << j)) // Led is on
+      if(x != 0 && x % 8 == 0) // Vertical separation between drivers
+        Serial.print("+ ");
+      
+      if(testLed(x, y)) // Led is on
         Serial.print("X ");
       else // Led is off
         Serial.print(". ");
@@ -23,8 +23,72 @@
 #define MAX_REG_SHUTDOWN       0x0C
 #define MAX_REG_DISPLAYTEST    0x0F
 
-#define BRIGHTNESS_UPDATE_INTERVAL 50UL
-#define BRIGHTNESS_UPDATE_THRESHOLD 10
+// Fastest serial clock supported by the MAX7219
+#define MAX7219_MAX_CLOCK 10000000UL
+
+#define BRIGHTNESS_UPDATE_INTERVAL 50UL // The auto brightness moves one level at most per update
+#define BRIGHTNESS_HYSTERESIS 12 // Photocell margin around the level thresholds
+
+// Background flush : chain transactions queued for the SPI interrupt (a full frame plus two commands)
+#define DISPLAY_QUEUE_TRANSACTIONS 10
+
+// Glyph blitting modes
+#define BLIT_COPY 0 // The area of the bitmap is replaced by the bitmap
+#define BLIT_OR 1 // LEDs lit in the bitmap are turned on
+#define BLIT_AND 2 // LEDs of the area are kept only where the bitmap is lit
+#define BLIT_XOR 3 // LEDs lit in the bitmap are toggled
+
+// 3 * 5 font, from ' ' to '`' (lowercase letters are drawn uppercase)
+#define FONT_WIDTH 3
+#define FONT_HEIGHT 5
+#define FONT_FIRST ' '
+#define FONT_LAST '`'
+#define FONT_DEGREE '`' // The degree sign takes the place of the backquote
+
+// Chain topologies (DISPLAY_CHAIN in settings.h), driver #0 being the closest to the MCU
+#define DISPLAY_CHAIN_ROWS 0 // Left to right, then top to bottom
+#define DISPLAY_CHAIN_SERPENTINE 1 // Left to right on even block rows, right to left on odd ones
+#define DISPLAY_CHAIN_COLUMNS 2 // Top to bottom, then left to right
+
+// Geometry derived from settings.h
+#define DISPLAY_BLOCKS_X (DISPLAY_WIDTH / 8)
+#define DISPLAY_BLOCKS_Y (DISPLAY_HEIGHT / 8)
+#define DISPLAY_DRIVERS (DISPLAY_BLOCKS_X * DISPLAY_BLOCKS_Y)
+
+#if DISPLAY_WIDTH % 8 != 0 || DISPLAY_HEIGHT % 8 != 0 || DISPLAY_DRIVERS < 1
+  #error "DISPLAY_WIDTH and DISPLAY_HEIGHT must be non-zero multiples of 8"
+#endif
+
+#if DISPLAY_SPI_CLOCK > MAX7219_MAX_CLOCK
+  #error "DISPLAY_SPI_CLOCK is faster than the MAX7219 can handle"
+#endif
+
+#if DISPLAY_WIDTH > 64
+  #error "DISPLAY_WIDTH is limited to 64 (rows are stored in a DisplayRow)"
+#endif
+
+// One bit per LED of a row, the leftmost LED being the most significant bit
+#if DISPLAY_WIDTH <= 16
+  typedef word DisplayRow;
+#elif DISPLAY_WIDTH <= 32
+  typedef unsigned long DisplayRow;
+#else
+  typedef unsigned long long DisplayRow;
+#endif
+
+#define DISPLAY_QUEUE_SIZE (DISPLAY_QUEUE_TRANSACTIONS * DISPLAY_DRIVERS * 2 + 1) // One slot stays empty
+
+#define DISPLAY_ROW_MASK ((DisplayRow)(((DisplayRow)1 << (DISPLAY_WIDTH - 1)) * 2 - 1))
+
+// Index in the buffer (row-major 8 * 8 blocks) of the driver at a given position of the chain (tabulated by Display)
+constexpr int displayChainBlock(int chainPos)
+{
+  return DISPLAY_CHAIN == DISPLAY_CHAIN_COLUMNS ?
+      (chainPos % DISPLAY_BLOCKS_Y) * DISPLAY_BLOCKS_X + chainPos / DISPLAY_BLOCKS_Y
+    : DISPLAY_CHAIN == DISPLAY_CHAIN_SERPENTINE && (chainPos / DISPLAY_BLOCKS_X) % 2 == 1 ?
+      (chainPos / DISPLAY_BLOCKS_X) * DISPLAY_BLOCKS_X + DISPLAY_BLOCKS_X - 1 - chainPos % DISPLAY_BLOCKS_X
+    : chainPos;
+}
 
 class Display
 {
@@ -33,13 +97,28 @@ class Display
     void setTestMode(boolean testMode);
     void clear();
     void display();
+    void setBackgroundFlush(boolean enabled);
+    boolean isBusy();
+    void waitFlush();
+    unsigned long setSpiClock(unsigned long clock);
+    unsigned long getSpiClock();
     void setLed(int x, int y, boolean val);
     boolean testLed(int x, int y);
+    DisplayRow getRow(int y);
+    void setRow(int y, DisplayRow row);
     void setDigit(int x, int y, int digit);
-    void testPattern();
+    void blit(int x, int y, const byte *bitmap, byte width, byte height, byte mode = BLIT_COPY);
+    void drawGlyph(int x, int y, char c, byte mode = BLIT_COPY);
+    int drawText(int x, int y, const char *text, byte mode = BLIT_COPY);
+    void drawByte(int column, int y, byte bits, byte mode = BLIT_COPY);
+    void scrollLeft(int y, int height);
+    static byte getGlyphRow(char c, int row);
     boolean empty();
+    unsigned int getFlushRegisters();
+    unsigned int getFlushBytes();
+    unsigned long getTotalBytes();
     int adjustBrightness();
-    void updateBrightness();
+    void updateBrightness(int light);
     
     #ifdef DEBUG
       void printBuffer();
@@ -47,20 +126,46 @@ class Display
     #endif
   
   private:
-    byte m_buffer[4][8];
-    byte m_backBuffer[4][8];
+    byte m_buffer[DISPLAY_DRIVERS][8]; // Row-major 8 * 8 blocks, one byte per block row (MSB = leftmost LED)
+    byte m_backBuffer[DISPLAY_DRIVERS][8];
+    byte m_dirty[DISPLAY_DRIVERS]; // One bit per digit modified since the last display()
+    byte m_chainBlock[DISPLAY_DRIVERS]; // displayChainBlock() of each position of the chain
+    unsigned int m_flushRegisters;
+    unsigned int m_flushBytes;
+    unsigned long m_totalBytes;
+    unsigned long m_spiClock;
     int m_brightness; // -1 = auto
-    unsigned long m_lastBrightnessUpdate;
-    int m_lastBrightnessValue;
-    static const byte m_sevenSegDigit[10];
-    static const int m_sevenSegTemplate[7][2][3];
+    byte m_brightnessTarget; // Auto mode level
+    byte m_intensity; // Last value sent to the drivers
+    static const byte m_spiClockDividers[7];
+    static const unsigned int m_brightnessThresholds[16];
+    static const byte m_font[FONT_LAST - FONT_FIRST + 1][FONT_HEIGHT];
     
     int m_adjustingBrightness;
     
     InputHandler *m_inputs;
   
+    // Background flush (see setBackgroundFlush())
+    boolean m_backgroundFlush;
+    byte m_queue[DISPLAY_QUEUE_SIZE];
+    unsigned int m_queueHead; // Next free slot, only written by the main code
+    unsigned int m_queueWrite; // Where the transaction being queued is written
+    volatile unsigned int m_queueTail; // Next byte to send, only written by the SPI interrupt
+    volatile byte m_queueSentInTransaction;
+    volatile boolean m_spiBusy;
+    
     void sendAll(byte reg, byte val);
     void setBrightness(byte val);
+    void blitByte(int column, int y, byte bits, byte mask, byte mode);
+    static const byte *getGlyph(char c);
+    
+    void beginTransaction();
+    void sendByte(byte val);
+    void endTransaction();
+    void startBackgroundTransfer();
+    
+  public:
+    void spiTransferComplete(); // Called by the SPI interrupt
 };
 
 #endif
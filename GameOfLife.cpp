@@ -6,6 +6,8 @@
  * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
  * ---------
  * GameOfLife.cpp : Implements the GameOfLife class (Connway's game of life).
+ * Each generation is hashed and compared with the last GOL_HISTORY ones, so that a world stuck in a still life
+ * or an oscillator is reset as soon as it repeats itself.
  */
  
 #if defined(ARDUINO) && ARDUINO >= 100
@@ -18,115 +20,295 @@
 #include "Display.h"
 #include "settings.h"
 
+// FNV-1a, one row at a time
+#define GOL_HASH_BASIS 2166136261UL
+#define GOL_HASH_PRIME 16777619UL
+
+// Bits of a where s is clear, bits of b where s is set
+#define GOL_SELECT(a, b, s) ((a) ^ (((a) ^ (b)) & (s)))
+
+// Rules of GOL_RULE_PRESETS, selected by setRulePreset()
+const char GameOfLife::m_rulePresets[GOL_RULE_PRESETS][GOL_RULE_LENGTH] PROGMEM =
+{
+  "B3/S23", // Conway's Game of Life
+  "B36/S23", // HighLife
+  "B2/S", // Seeds
+  "B3678/S34678", // Day & Night
+  "B368/S245", // Morley
+  "B1357/S1357", // Replicator
+  "B3/S012345678", // Life without death
+  "B35678/S5678" // Diamoeba
+};
+
 // Constructor
 GameOfLife::GameOfLife(Display *disp)
 {
   m_disp = disp;
   m_step = 0U;
-  m_lastUpdateTime = 0UL;
+  m_wrap = false;
+  
+  setRulePreset(0);
+  clearHistory();
 }
 
-// Used to go one generation forward
-void GameOfLife::getNextStep()
+// Used to set the rule from its B/S notation ("B3/S23" : birth with 3 neighbours, survival with 2 or 3).
+// Each count gets the next state of its cells : dead, alive if dead (birth), unchanged (survival), or alive.
+// Returns false, the rule being unchanged, if the notation is wrong.
+boolean GameOfLife::setRule(const char *rule)
 {
-  boolean backupWorld[16][16] = {{false}};
+  word masks[2] = {0, 0}; // Birth and survival counts, one bit per count
+  int set = -1;
   
-  // Increment step counter
-  m_step++;
-  
-  // Backup current state
-  for(int i = 0 ; i < 16 ; i++)
+  for(const char *c = rule ; *c != '\0' ; c++)
   {
-    for(int j = 0 ; j < 16 ; j++)
-    {
-      backupWorld[i][j] = m_disp->testLed(i, j);
-    }
+    if(*c == 'B' || *c == 'b')
+      set = 0;
+    else if(*c == 'S' || *c == 's')
+      set = 1;
+    else if(*c >= '0' && *c <= '8' && set >= 0)
+      masks[set] |= 1 << (*c - '0');
+    else if(*c != '/')
+      return false;
   }
   
-  // Update cells
-  for(int x = 0 ; x < 16 ; x++)
+  for(int i = 0 ; i <= 8 ; i++)
+    m_rule[i] = ((masks[0] >> i) & 1) | (((masks[1] >> i) & 1) << 1);
+  
+  m_conway = masks[0] == B00001000 && masks[1] == B00001100; // B3/S23 : fast path of getNextStep()
+  
+  return true;
+}
+
+// Used to set one of the rules of m_rulePresets
+void GameOfLife::setRulePreset(byte preset)
+{
+  char rule[GOL_RULE_LENGTH];
+  
+  for(int i = 0 ; i < GOL_RULE_LENGTH ; i++)
+    rule[i] = pgm_read_byte(&m_rulePresets[preset % GOL_RULE_PRESETS][i]);
+  
+  setRule(rule);
+}
+
+// Used to choose between a world with dead cells all around (false) and a torus, whose opposite edges touch (true)
+void GameOfLife::setWrap(boolean wrap)
+{
+  m_wrap = wrap;
+}
+
+// Used to know if the world is a torus
+boolean GameOfLife::getWrap()
+{
+  return m_wrap;
+}
+
+// Used to align the neighbour on the right of each cell with the cell (see nextRows())
+DisplayRow GameOfLife::shiftLeft(DisplayRow row, boolean wrap)
+{
+  if(wrap)
+    return ((row << 1) | (row >> (DISPLAY_WIDTH - 1))) & DISPLAY_ROW_MASK;
+  
+  return (row << 1) & DISPLAY_ROW_MASK;
+}
+
+// Used to align the neighbour on the left of each cell with the cell
+DisplayRow GameOfLife::shiftRight(DisplayRow row, boolean wrap)
+{
+  if(wrap)
+    return ((row >> 1) | (row << (DISPLAY_WIDTH - 1))) & DISPLAY_ROW_MASK;
+  
+  return row >> 1;
+}
+
+// Used to compute the next generation in place, returning its hash (see getNextStep())
+// Each row is a DisplayRow (one bit per cell) : the eight neighbours of all the
+// cells of a row are counted at once with bitwise adders, and the rule is applied
+// to all of them at once too (see setRule()). wrap and conway are template parameters
+// so that B3/S23 with dead edges compiles to the plain shifts and adders of the fixed rule.
+template<boolean wrap, boolean conway> unsigned long GameOfLife::nextRows()
+{
+  Display *disp = m_disp; // Out of the members too, like the rule below
+  
+  // Row y + 1 is read before row y is overwritten, so no backup of the world is needed
+  // (on a torus, row 0 is kept for the last row)
+  DisplayRow first = disp->getRow(0);
+  DisplayRow above = wrap ? disp->getRow(DISPLAY_HEIGHT - 1) : 0; // Row y - 1 (dead outside the world)
+  DisplayRow aboveLeft = shiftLeft(above, wrap), aboveRight = shiftRight(above, wrap);
+  DisplayRow aboveOnes = aboveLeft ^ above ^ aboveRight;
+  DisplayRow aboveTwos = (aboveLeft & above) | (aboveRight & (aboveLeft ^ above));
+  DisplayRow cur = first;
+  DisplayRow curLeft = shiftLeft(cur, wrap), curRight = shiftRight(cur, wrap);
+  DisplayRow curOnes = curLeft ^ cur ^ curRight; // Live cells among x - 1, x, x + 1 (bit 0)
+  DisplayRow curTwos = (curLeft & cur) | (curRight & (curLeft ^ cur)); // (bit 1)
+  unsigned long hash = GOL_HASH_BASIS;
+  
+  // The rule, out of the members that setRow() could change as far as the compiler knows
+  byte rule[9];
+  
+  for(int i = 0 ; i < 9 ; i++)
+    rule[i] = m_rule[i];
+  
+  for(int y = 0 ; y < DISPLAY_HEIGHT ; y++)
   {
-    for(int y = 0 ; y < 16 ; y++)
+    // Horizontal sums of the row below
+    DisplayRow below = (y < DISPLAY_HEIGHT - 1) ? disp->getRow(y + 1) : (wrap ? first : 0);
+    DisplayRow belowLeft = shiftLeft(below, wrap), belowRight = shiftRight(below, wrap);
+    DisplayRow belowOnes = belowLeft ^ below ^ belowRight;
+    DisplayRow belowTwos = (belowLeft & below) | (belowRight & (belowLeft ^ below));
+    
+    // Neighbours on the same row (the cell itself is not counted)
+    DisplayRow sideOnes = curLeft ^ curRight;
+    DisplayRow sideTwos = curLeft & curRight;
+    
+    // Add the three 2 bit counts : bit 0, carry into bit 1
+    DisplayRow bit0 = aboveOnes ^ sideOnes ^ belowOnes;
+    DisplayRow carry0 = (aboveOnes & sideOnes) | (belowOnes & (aboveOnes ^ sideOnes));
+    
+    // Bits 1 to 3 (bit 3 is only set by a count of 8, bits 0 to 2 are then clear)
+    DisplayRow sum1 = aboveTwos ^ sideTwos ^ belowTwos;
+    DisplayRow carry1 = (aboveTwos & sideTwos) | (belowTwos & (aboveTwos ^ sideTwos));
+    DisplayRow carry2 = sum1 & carry0;
+    DisplayRow bit1 = sum1 ^ carry0;
+    DisplayRow bit2 = carry1 ^ carry2;
+    DisplayRow next;
+    
+    // Conway : 3 neighbours -> alive, 2 neighbours -> unchanged, otherwise dead
+    if(conway)
+      next = bit1 & ~bit2 & (bit0 | cur);
+    else
     {
-      // Count the number of neighbors
-      int neighbors = 0;
-      
-      if(x > 0 && y > 0 && backupWorld[x-1][y-1] == true) // top left
-        neighbors++;
-      
-      if(y > 0 && backupWorld[x][y-1] == true) // top
-        neighbors++;
-        
-      if(x < 15 && y > 0 && backupWorld[x+1][y-1] == true) // top right
-        neighbors++;
-        
-      if(x < 15 && backupWorld[x+1][y] == true) // right
-        neighbors++;
-        
-      if(x < 15 && y < 15 && backupWorld[x+1][y+1] == true) // bottom right
-        neighbors++;
-      
-      if(y < 15 && backupWorld[x][y+1] == true) // bottom
-        neighbors++;
-        
-      if(x > 0 && y < 15 && backupWorld[x-1][y+1] == true) // bottom left
-        neighbors++;
-        
-      if(x > 0 && backupWorld[x-1][y] == true) // left
-        neighbors++;
-        
-        
-      // Update the cell accordingly
-      if(backupWorld[x][y] == true && (neighbors > 3 || neighbors < 2)) // cell is alive and has too few or too much neighbors -> turn it off
-        m_disp->setLed(x, y, false);
-      else if(backupWorld[x][y] == false && neighbors == 3) // cell is dead and has 3 neighbors -> turn it on
-        m_disp->setLed(x, y, true);
+      // Next state of the cells for each count, then the one of their count is picked bit by bit
+      DisplayRow bit3 = carry1 & carry2;
+      DisplayRow states[4] = {0, (DisplayRow)~cur, cur, (DisplayRow)~0};
+      DisplayRow count01 = GOL_SELECT(states[rule[0]], states[rule[1]], bit0);
+      DisplayRow count23 = GOL_SELECT(states[rule[2]], states[rule[3]], bit0);
+      DisplayRow count45 = GOL_SELECT(states[rule[4]], states[rule[5]], bit0);
+      DisplayRow count67 = GOL_SELECT(states[rule[6]], states[rule[7]], bit0);
+      DisplayRow count03 = GOL_SELECT(count01, count23, bit1);
+      DisplayRow count47 = GOL_SELECT(count45, count67, bit1);
+      next = GOL_SELECT(GOL_SELECT(count03, count47, bit2), states[rule[8]], bit3) & DISPLAY_ROW_MASK;
     }
+    
+    disp->setRow(y, next);
+    hash = (hash ^ next) * GOL_HASH_PRIME;
+    
+    // Slide the window down
+    aboveOnes = curOnes; aboveTwos = curTwos;
+    cur = below;
+    curLeft = belowLeft; curRight = belowRight;
+    curOnes = belowOnes; curTwos = belowTwos;
   }
+  
+  return hash;
 }
 
-// Used to automatically go to the next step
-boolean GameOfLife::autoNextStep()
+// Used to go one generation forward
+void GameOfLife::getNextStep()
 {
-  int potVal = analogRead(PIN_POT);
+  // Increment step counter
+  m_step++;
+  
+  unsigned long hash;
   
-  if(millis() - m_lastUpdateTime >= (unsigned long)(potVal < 512 ? map(potVal, 0, 511, 10, 200) : map(potVal, 512, 1023, 200, 5000)) || m_lastUpdateTime == 0) // Update needed
+  if(m_wrap)
+    hash = m_conway ? nextRows<true, true>() : nextRows<true, false>();
+  else
+    hash = m_conway ? nextRows<false, true>() : nextRows<false, false>();
+  
+  // Same world as p generations ago : it is in a cycle of period p
+  for(byte p = 1 ; p <= m_historyCount && m_period == 0 ; p++)
   {
-    getNextStep();
-    m_lastUpdateTime = millis();
-    
-    return true;
+    if(m_history[(m_historyIndex + GOL_HISTORY - p) % GOL_HISTORY] == hash)
+      m_period = p;
   }
-  else // Nothing to do
-    return false;
+  
+  m_history[m_historyIndex] = hash;
+  m_historyIndex = (m_historyIndex + 1) % GOL_HISTORY;
+  
+  if(m_historyCount < GOL_HISTORY)
+    m_historyCount++;
+}
+
+// Used to get the time between two generations (ms), set by the potentiometer reading
+unsigned long GameOfLife::getStepPeriod(int pot)
+{
+  return (unsigned long)(pot < 512 ? map(pot, 0, 511, 10, 200) : map(pot, 512, 1023, 200, 5000));
 }
 
 // Used to get a random initialization
 void GameOfLife::initialize()
 {
   m_step = 0U;
+  clearHistory();
   
-  for(int i = 0 ; i < 16 ; i++)
+  for(int y = 0 ; y < DISPLAY_HEIGHT ; y++)
   {
-    for(int j = 0 ; j < 16 ; j++)
-    {
-      if(random(2) == 0)
-        m_disp->setLed(i, j, true);
-      else
-        m_disp->setLed(i, j, false);
-    }
+    DisplayRow row = 0;
+    
+    for(int i = 0 ; i < DISPLAY_BLOCKS_X ; i++) // One random bit per cell
+      row = (row << 8) | (DisplayRow)random(256);
+    
+    m_disp->setRow(y, row);
   }
 }
 
-// Used to check if a reset is needed
+// Used to check if a reset is needed (no more live cells, cycle, or too much steps)
 void GameOfLife::autoReset()
 {
-  if(m_step > GOL_MAX_ITERATION || m_disp->empty())
+  if(m_period != 0 || m_step > GOL_MAX_ITERATION || m_disp->empty())
+  {
+    #ifdef DEBUG
+      printStats();
+    #endif
+    
     initialize();
+  }
 }
 
-// Used to reset the step counter
+// Used to reset the step counter, when the world was drawn by something else
 void GameOfLife::resetStepCounter()
 {
   m_step = 0U;
+  clearHistory();
+}
+
+// Used to get the number of generations since the world was initialized
+unsigned int GameOfLife::getGeneration()
+{
+  return m_step;
 }
+
+// Used to get the period of the cycle the world is in (1 for a still life), 0 if none was found
+byte GameOfLife::getPeriod()
+{
+  return m_period;
+}
+
+// Used to count the live cells
+unsigned int GameOfLife::getPopulation()
+{
+  unsigned int population = 0U;
+  
+  for(int y = 0 ; y < DISPLAY_HEIGHT ; y++)
+  {
+    for(DisplayRow row = m_disp->getRow(y) ; row != 0 ; population++)
+      row &= row - 1; // Clear the lowest live cell
+  }
+  
+  return population;
+}
+
+// Used to forget the previous generations
+void GameOfLife::clearHistory()
+{
+  m_historyIndex = 0;
+  m_historyCount = 0;
+  m_period = 0;
+}
+
+#ifdef DEBUG
+void GameOfLife::printStats()
+{
+  Serial.println("Generation " + String(m_step) + ", " + String(getPopulation()) + " cells, period " + String(m_period));
+}
+#endif
@@ -11,7 +11,10 @@
 #ifndef DEF_GAMEOFLIFE
 #define DEF_GAMEOFLIFE
 
-#define GOL_MAX_ITERATION 95
+#define GOL_MAX_ITERATION 1000 // Reset of the worlds whose cycle is too long to be detected
+#define GOL_HISTORY 8 // Hashes of the last generations (4 bytes each) : cycles up to this period are detected
+#define GOL_RULE_PRESETS 8 // Rules selected by setRulePreset(), see GameOfLife.cpp
+#define GOL_RULE_LENGTH 14 // B/S notation of the presets, terminating null included
 
 #include "Display.h"
 
@@ -23,12 +26,40 @@ class GameOfLife
     void initialize();
     void autoReset();
     void resetStepCounter();
-    boolean autoNextStep();
+    boolean setRule(const char *rule);
+    void setRulePreset(byte preset);
+    void setWrap(boolean wrap);
+    boolean getWrap();
+    unsigned long getStepPeriod(int pot);
+    unsigned int getGeneration();
+    byte getPeriod();
+    unsigned int getPopulation();
+    
+    #ifdef DEBUG
+      void printStats();
+    #endif
   
   private:
     Display *m_disp;
     unsigned int m_step;
-    unsigned long m_lastUpdateTime;
+    
+    // Rule
+    byte m_rule[9]; // For each count of live neighbours : bit 0 = birth, bit 1 = survival
+    boolean m_conway; // m_rule is B3/S23
+    boolean m_wrap; // Torus
+    static const char m_rulePresets[GOL_RULE_PRESETS][GOL_RULE_LENGTH];
+    
+    static DisplayRow shiftLeft(DisplayRow row, boolean wrap);
+    static DisplayRow shiftRight(DisplayRow row, boolean wrap);
+    template<boolean wrap, boolean conway> unsigned long nextRows();
+    
+    // Cycle detection
+    unsigned long m_history[GOL_HISTORY]; // Ring of the hashes of the last generations
+    byte m_historyIndex; // Slot of the next hash
+    byte m_historyCount;
+    byte m_period; // Period of the cycle the world is in, 0 until one is found
+    
+    void clearHistory();
 };
 
 #endif
@@ -6,8 +6,11 @@
  * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
  * ---------
  * InputHandler.cpp : implements the InputHandle class, which is used to debounce the buttons inputs.
+ * The pin interrupts queue every edge with its time, the debouncing and the gestures (short and long
+ * press, auto-repeat, PLUS + MINUS chord) are then worked out from that queue, so no press is lost while
+ * the main loop is busy.
  */
- 
+
 #if defined(ARDUINO) && ARDUINO >= 100
   #include <Arduino.h>
 #else
@@ -15,50 +18,207 @@
 #endif
 
 #include "InputHandler.h"
+#include "PinChange.h"
 #include "settings.h"
 
+// Buttons sampled by the interrupts
+static InputHandler *interruptInputs = NULL;
+
+static void buttonInterrupt()
+{
+  if(interruptInputs != NULL)
+    interruptInputs->sampleButtons();
+}
+
 // Constructor
 InputHandler::InputHandler()
 {
+  m_eventHead = 0;
+  m_eventTail = 0;
+  m_sampledLevels = 0;
+  m_pendingChords = 0;
+  m_chord = false;
+
   for(int i = 0 ; i < 3 ; i++)
   {
     pinMode(m_buttonPins[i], INPUT); // Set the button pins to inputs
-    
+
     // Initialize the arrays
     m_buttonState[i] = false;
     m_lastButtonState[i] = false;
-    m_lastButtonReading[i] = false;
-    m_debounceStartTime[i] = 0UL;
+    m_rawState[i] = false;
+    m_rawChangeTime[i] = 0UL;
     m_lastButtonChangeTime[i] = 0UL;
+    m_pendingPresses[i] = 0;
+    m_pendingShortPresses[i] = 0;
+    m_press[i] = false;
+    m_shortPress[i] = false;
+    m_chordPress[i] = false;
+    m_longPress[i] = false;
+    m_longPressDone[i] = false;
+    m_repeat[i] = false;
+    m_nextRepeatTime[i] = 0UL;
+  }
+
+  interruptInputs = this;
+
+  for(int i = 0 ; i < 3 ; i++)
+  {
+    int interrupt = digitalPinToInterrupt(m_buttonPins[i]);
+
+    if(interrupt != NOT_AN_INTERRUPT)
+      attachInterrupt(interrupt, buttonInterrupt, CHANGE);
+    else // Pin change interrupt of its port, polled by updateButtonsStates() if there is none
+      attachPinChange(m_buttonPins[i], buttonInterrupt);
   }
 }
 
 // Allows to store the three pins in an array
 const int InputHandler::m_buttonPins[3] = {PIN_MODE, PIN_PLUS, PIN_MINUS};
 
+// Used to queue the edges of the buttons, from the interrupts or from updateButtonsStates()
+void InputHandler::sampleButtons()
+{
+  byte levels = 0;
+
+  for(int i = 0 ; i < 3 ; i++)
+  {
+    if(digitalRead(m_buttonPins[i]) == HIGH)
+      levels |= 1 << i;
+  }
+
+  for(int i = 0 ; i < 3 ; i++)
+  {
+    if(((levels ^ m_sampledLevels) & (1 << i)) == 0)
+      continue;
+
+    byte next = (m_eventHead + 1) & (INPUT_EVENTS - 1);
+
+    if(next == m_eventTail) // Queue full : keep the old level so that the edge is queued next time
+    {
+      levels ^= 1 << i;
+      continue;
+    }
+
+    m_eventButton[m_eventHead] = i | ((levels & (1 << i)) ? 0x80 : 0x00);
+    m_eventTime[m_eventHead] = millis();
+    m_eventHead = next;
+  }
+
+  m_sampledLevels = levels;
+}
+
 // Used to update the value of the buttons
 void InputHandler::updateButtonsStates()
 {
+  // Catch the edges of the pins without interrupt
+  noInterrupts();
+  sampleButtons();
+  interrupts();
+
+  unsigned long now = millis();
+
+  for(int i = 0 ; i < 3 ; i++)
+  {
+    m_lastButtonState[i] = m_buttonState[i];
+    m_press[i] = false;
+    m_shortPress[i] = false;
+    m_longPress[i] = false;
+    m_repeat[i] = false;
+  }
+
+  // Each edge ends the previous level, which is kept if it was stable long enough
+  while(m_eventTail != m_eventHead)
+  {
+    byte event = m_eventButton[m_eventTail];
+    unsigned long time = m_eventTime[m_eventTail];
+    int button = event & 0x03;
+
+    m_eventTail = (m_eventTail + 1) & (INPUT_EVENTS - 1);
+
+    if(m_rawState[button] != m_buttonState[button] && time - m_rawChangeTime[button] >= DEBOUNCE_DELAY)
+      changeState(button, m_rawState[button], m_rawChangeTime[button] + DEBOUNCE_DELAY);
+
+    m_rawState[button] = (event & 0x80) ? HIGH : LOW;
+    m_rawChangeTime[button] = time;
+  }
+
   for(int i = 0 ; i < 3 ; i++)
   {
-    boolean reading = digitalRead(m_buttonPins[i]);
-    
-    if(reading != m_lastButtonReading[i]) // Bouncing
-      m_debounceStartTime[i] = millis();
-      
-    if(reading == m_lastButtonReading[i] && millis() - m_debounceStartTime[i] >= DEBOUNCE_DELAY) // Not bouncing anymore
+    // Current level, not bouncing anymore
+    if(m_rawState[i] != m_buttonState[i] && now - m_rawChangeTime[i] >= DEBOUNCE_DELAY)
+      changeState(i, m_rawState[i], m_rawChangeTime[i] + DEBOUNCE_DELAY);
+
+    // One queued press is reported per update
+    if(m_pendingPresses[i] > 0)
+    {
+      m_press[i] = true;
+      m_pendingPresses[i]--;
+    }
+
+    if(m_pendingShortPresses[i] > 0)
     {
-      m_lastButtonState[i] = m_buttonState[i];
-      m_buttonState[i] = reading;
-      
-      if(m_lastButtonState[i] != m_buttonState[i]) // Button changed state
+      m_shortPress[i] = true;
+      m_pendingShortPresses[i]--;
+    }
+
+    if(m_buttonState[i] == HIGH)
+    {
+      if(!m_longPressDone[i] && now - m_lastButtonChangeTime[i] >= LONG_PRESS_DELAY)
+      {
+        m_longPress[i] = true;
+        m_longPressDone[i] = true;
+      }
+
+      if((long)(now - m_nextRepeatTime[i]) >= 0)
       {
-        m_lastButtonChangeTime[i] = millis();
+        m_repeat[i] = true;
+        m_nextRepeatTime[i] += REPEAT_INTERVAL;
+
+        if((long)(now - m_nextRepeatTime[i]) >= 0) // Late, do not catch up
+          m_nextRepeatTime[i] = now + REPEAT_INTERVAL;
       }
     }
-    
-    m_lastButtonReading[i] = reading;
   }
+
+  m_chord = m_pendingChords > 0;
+
+  if(m_chord)
+    m_pendingChords--;
+}
+
+// Used to apply a debounced change of a button and queue the resulting gesture
+void InputHandler::changeState(int button, boolean state, unsigned long time)
+{
+  unsigned long heldTime = time - m_lastButtonChangeTime[button];
+
+  m_buttonState[button] = state;
+  m_lastButtonChangeTime[button] = time;
+
+  if(state == LOW)
+  {
+    // Released before making a long press, and not part of a chord
+    if(!m_longPressDone[button] && heldTime < LONG_PRESS_DELAY && !m_chordPress[button] && m_pendingShortPresses[button] < 255)
+      m_pendingShortPresses[button]++;
+
+    return;
+  }
+
+  m_longPressDone[button] = false;
+  m_chordPress[button] = false;
+  m_nextRepeatTime[button] = time + REPEAT_DELAY;
+
+  // PLUS pressed while MINUS is held, or the opposite
+  if((button == PLUS && m_buttonState[MINUS] == HIGH) || (button == MINUS && m_buttonState[PLUS] == HIGH))
+  {
+    m_chordPress[PLUS] = true;
+    m_chordPress[MINUS] = true;
+
+    if(m_pendingChords < 255)
+      m_pendingChords++;
+  }
+  else if(m_pendingPresses[button] < 255)
+    m_pendingPresses[button]++;
 }
 
 // Used to get the debounced reading of a button
@@ -67,7 +227,7 @@ boolean InputHandler::getButtonState(int button)
   return m_buttonState[button];
 }
 
-// Used to get the last button state
+// Used to get the button state before the last update
 boolean InputHandler::getLastButtonState(int button)
 {
   return m_lastButtonState[button];
@@ -76,7 +236,31 @@ boolean InputHandler::getLastButtonState(int button)
 // Used to get a single button press (the button must be released between each push)
 boolean InputHandler::getSinglePress(int button)
 {
-  return m_buttonState[button] == HIGH && m_lastButtonState[button] == LOW ? true : false;
+  return m_press[button];
+}
+
+// Used to get a press once the button is released, if it was not held for LONG_PRESS_DELAY nor part of a chord
+boolean InputHandler::getShortPress(int button)
+{
+  return m_shortPress[button];
+}
+
+// Used to know if the button has just been held for LONG_PRESS_DELAY (reported once per press)
+boolean InputHandler::getLongPress(int button)
+{
+  return m_longPress[button];
+}
+
+// Used to get a press, then a repeated press every REPEAT_INTERVAL while the button is held
+boolean InputHandler::getRepeatPress(int button)
+{
+  return m_press[button] || m_repeat[button];
+}
+
+// Used to know if PLUS and MINUS have just been pressed together
+boolean InputHandler::getChord()
+{
+  return m_chord;
 }
 
 // Used to got the time since the button is in the current position
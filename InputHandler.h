@@ -7,12 +7,16 @@
  * ---------
  * InputHandler.h : InputHandler class definition.
  */
- 
+
 #ifndef DEF_INPUTHANDLER
 #define DEF_INPUTHANDLER
 
-#define DEBOUNCE_DELAY 10
+#define DEBOUNCE_DELAY 10UL
+#define LONG_PRESS_DELAY 1000UL // A button held this long makes a long press
+#define REPEAT_DELAY 500UL // A button held this long starts repeating
+#define REPEAT_INTERVAL 100UL
 
+#define INPUT_EVENTS 16 // Size of the edge event ring buffer, power of two
 
 // Lambda enumeration to make the code more readable
 enum{MODE = 0, PLUS = 1, MINUS = 2};
@@ -25,17 +29,45 @@ class InputHandler
     boolean getButtonState(int button);
     boolean getLastButtonState(int button);
     boolean getSinglePress(int button);
+    boolean getShortPress(int button);
+    boolean getLongPress(int button);
+    boolean getRepeatPress(int button);
+    boolean getChord();
     unsigned long getLastChangeTime(int button);
-  
+
+    void sampleButtons(); // Called from the pin interrupts
+
   private:
     boolean m_buttonState[3];
     boolean m_lastButtonState[3];
-    boolean m_lastButtonReading[3];
-    unsigned long m_debounceStartTime[3];
+    boolean m_rawState[3];
+    unsigned long m_rawChangeTime[3];
     unsigned long m_lastButtonChangeTime[3];
-    
+
+    // Gestures
+    byte m_pendingPresses[3];
+    byte m_pendingChords;
+    byte m_pendingShortPresses[3];
+    boolean m_press[3];
+    boolean m_shortPress[3];
+    boolean m_chordPress[3]; // The current press is part of a chord
+    boolean m_longPress[3];
+    boolean m_longPressDone[3];
+    boolean m_repeat[3];
+    unsigned long m_nextRepeatTime[3];
+    boolean m_chord;
+
+    // Edge events written by the interrupts
+    volatile byte m_eventButton[INPUT_EVENTS];
+    volatile unsigned long m_eventTime[INPUT_EVENTS];
+    volatile byte m_eventHead;
+    volatile byte m_eventTail;
+    volatile byte m_sampledLevels;
+
+    void changeState(int button, boolean state, unsigned long time);
+
     static const int m_buttonPins[3];
-    
+
 };
 
 #endif
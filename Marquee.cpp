@@ -0,0 +1,84 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * Marquee.cpp : Implements the Marquee class, which scrolls a text from right to left, one column per step.
+ */
+
+#if defined(ARDUINO) && ARDUINO >= 100
+  #include <Arduino.h>
+#else
+  #include "WProgram.h"
+#endif
+
+#include "Marquee.h"
+#include "Display.h"
+
+// Constructor
+Marquee::Marquee(Display *disp)
+{
+  m_disp = disp;
+  m_text[0] = '\0';
+  m_y = 0;
+  m_column = 0;
+  m_columns = 0;
+  m_running = false;
+}
+
+// Used to scroll a text (copied) across the rows y to y + FONT_HEIGHT - 1, entering from the right
+void Marquee::start(const char *text, int y)
+{
+  int length = 0;
+  
+  while(length < MARQUEE_MAX_LENGTH && text[length] != '\0')
+  {
+    m_text[length] = text[length];
+    length++;
+  }
+  
+  m_text[length] = '\0';
+  
+  m_y = y;
+  m_column = 0;
+  m_columns = length * (FONT_WIDTH + 1);
+  m_running = true;
+}
+
+// Used to stop scrolling (the display buffer is left as is)
+void Marquee::stop()
+{
+  m_running = false;
+}
+
+// Used to know if the text is still scrolling
+boolean Marquee::isRunning()
+{
+  return m_running;
+}
+
+// Used to scroll by one column : the band is shifted and only the new rightmost column is drawn.
+// Returns true if the display buffer was modified (false once the text has left the display).
+boolean Marquee::step()
+{
+  if(!m_running)
+    return false;
+  
+  m_disp->scrollLeft(m_y, FONT_HEIGHT);
+  
+  if(m_column < m_columns)
+  {
+    char c = m_text[m_column / (FONT_WIDTH + 1)];
+    byte mask = B10000000 >> (m_column % (FONT_WIDTH + 1)); // The blank column between characters is never lit
+    
+    for(int i = 0 ; i < FONT_HEIGHT ; i++)
+      m_disp->setLed(DISPLAY_WIDTH - 1, m_y + i, Display::getGlyphRow(c, i) & mask);
+  }
+  
+  if(++m_column >= m_columns + DISPLAY_WIDTH)
+    m_running = false;
+  
+  return true;
+}
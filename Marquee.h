@@ -0,0 +1,36 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * Marquee.h : Marquee class definition.
+ */
+
+#ifndef DEF_MARQUEE
+#define DEF_MARQUEE
+
+#include "Display.h"
+
+#define MARQUEE_MAX_LENGTH 64 // Characters, longer texts are truncated
+
+class Marquee
+{
+  public:
+    Marquee(Display *disp);
+    void start(const char *text, int y);
+    void stop();
+    boolean isRunning();
+    boolean step();
+  
+  private:
+    Display *m_disp;
+    char m_text[MARQUEE_MAX_LENGTH + 1];
+    int m_y;
+    int m_column; // Column of the text entering the display
+    int m_columns; // Columns of the text, followed by a blank display width
+    boolean m_running;
+};
+
+#endif
@@ -10,7 +10,9 @@
  */
 
 #include <SPI.h>
-#include <Wire.h>
+#if !defined(__AVR__)
+  #include <Wire.h> // TwiBus drives the TWI itself on the board
+#endif
 #include <OneWire.h>
 #include <EEPROM.h>
 
@@ -20,8 +22,15 @@
 #include "InputHandler.h"
 #include "TempSensor.h"
 #include "SettingsHandler.h"
+#include "Animation.h"
+#include "Scheduler.h"
+#include "Marquee.h"
+#include "AnalogSampler.h"
+#include "SerialStream.h"
 
-#define CONTINUOUS_PRESS_THRESHOLD 1000UL
+#define INPUTS_UPDATE_INTERVAL 5UL
+#define STREAM_UPDATE_INTERVAL 1UL // The serial receive buffer (64 bytes) fills in 1.3 ms at 500000 baud
+#define STREAM_MODE_TIMEOUT 2000UL // Back to the Game of Life when the frames stop coming
 
 InputHandler inputs;
 Display disp(&inputs);
@@ -29,42 +38,280 @@ GameOfLife gol(&disp);
 TimeHandler time(&disp, &inputs);
 TempSensor temp(&disp);
 SettingsHandler settings(&disp, &inputs);
+Animation animation(&disp);
+Scheduler scheduler;
+Marquee marquee(&disp);
+AnalogSampler analog;
+#ifdef SERIAL_STREAM
+  SerialStream stream(&disp);
+#endif
 
 // Lambda enumaration for the mode selector
-enum{GOL = 0, TIME = 1 , DATE = 2, TEMP = 3, SETTINGS, TIME_ADJUST, BRIGHTNESS_ADJUST}; // GOL = GameOfLife
+enum{GOL = 0, TIME = 1 , DATE = 2, TEMP = 3, MARQUEE = 4, SETTINGS, TIME_ADJUST, BRIGHTNESS_ADJUST, STREAM}; // GOL = GameOfLife
 
 int mode = GOL;
 boolean autoModeChange = false;
 unsigned long lastModeChange = 0UL;
 unsigned int modeDuration[4] = {0};
+boolean streamFramePending = false;
+
+// Tasks
+void updateInputs();
+void updateBrightness();
+void updateGameOfLife();
+void updateClock();
+void startTempConversion();
+void readTemp();
+void updateMarquee();
+void updateStream();
+
+void startMarquee();
+
+byte golTask;
+byte clockTask;
+byte tempReadTask;
 
 void setup()
 {
-  randomSeed(analogRead(PIN_RAND));
+  analog.begin();
+  randomSeed(analog.getRaw(ANALOG_RAND));
 
-  #ifdef DEBUG
+  #ifdef SERIAL_STREAM
+    stream.begin(SERIAL_STREAM_BAUD); // The DEBUG prints share the port
+  #elif defined(DEBUG)
     Serial.begin(9600);
   #endif
   
+  // Let the SPI interrupt refresh the display while the loop goes on
+  disp.setBackgroundFlush(true);
+  
   time.initializeRTC();
-  disp.testPattern();
+  temp.initializeSensors();
+  
+  // Boot animation, played by loop() so that setup() returns immediately
+  #ifdef BOOT_ANIMATION
+    #if defined(__AVR__)
+      byte resetFlags = MCUSR; // May already be cleared by the bootloader, in which case the animation is played
+      MCUSR = 0;
+      
+      if(!(resetFlags & (_BV(WDRF) | _BV(BORF)))) // Fast restart after a watchdog or brown-out reset
+        animation.start(Animation::bootSweep);
+    #else
+      animation.start(Animation::bootSweep);
+    #endif
+  #endif
   
   // Read the saved settings
   settings.read();
   settings.getModeDurations(modeDuration);
   autoModeChange = settings.getBooleanSetting(SETTING_AUTO_MODE_CHANGE);
+  
+  if(settings.getBooleanSetting(SETTING_CLOCK_DISPLAY_MODE))
+    time.changeTimeDisplayMode();
+  
+  gol.setRulePreset(settings.getGolRule());
+  gol.setWrap(settings.getBooleanSetting(SETTING_GOL_WRAP));
+  
+  // Register the tasks
+  scheduler.addTask(updateInputs, INPUTS_UPDATE_INTERVAL);
+  scheduler.addTask(updateBrightness, BRIGHTNESS_UPDATE_INTERVAL);
+  golTask = scheduler.addTask(updateGameOfLife, gol.getStepPeriod(analog.getValue(ANALOG_POT)));
+  clockTask = scheduler.addTask(updateClock, 0UL); // One-shot, started again at each second
+  scheduler.runIn(clockTask, time.getTimeToNextTick());
+  scheduler.addTask(startTempConversion, TEMP_CHECK_INTERVAL);
+  tempReadTask = scheduler.addTask(readTemp, 0UL); // One-shot, started by startTempConversion()
+  scheduler.addTask(updateMarquee, MARQUEE_STEP_PERIOD);
+  
+  #ifdef SERIAL_STREAM
+    scheduler.addTask(updateStream, STREAM_UPDATE_INTERVAL);
+  #endif
 }
 
 void loop()
+{
+  // Run what is due, then sleep until the next deadline
+  scheduler.run();
+  scheduler.idle();
+}
+
+// ---------------------------------- TASKS -----------------------------------------------
+
+// Brightness : photocell reading in auto mode
+void updateBrightness()
+{
+  disp.updateBrightness(analog.getValue(ANALOG_PHOTOCELL));
+}
+
+// Game of life : one generation per period (set by the potentiometer)
+void updateGameOfLife()
+{
+  if(mode == GOL && !animation.isRunning())
+  {
+    gol.getNextStep();
+    gol.autoReset(); // Auto reset (no more live cells or too much steps)
+    disp.display();
+  }
+  
+  scheduler.setPeriod(golTask, gol.getStepPeriod(analog.getValue(ANALOG_POT)));
+}
+
+// Time and date modes : woken up at each second of the local time, redraw what changed
+void updateClock()
+{
+  byte changed = time.updateTime();
+  
+  if(mode == TIME && changed != 0)
+  {
+    time.displayTime();
+    disp.display();
+  }
+  else if(mode == DATE && (changed & TIME_CHANGED_DATE))
+  {
+    time.displayDate();
+    disp.display();
+  }
+  
+  scheduler.runIn(clockTask, time.getTimeToNextTick());
+}
+
+// Temperature : start a conversion, poll until it is done and read it
+void startTempConversion()
+{
+  if(mode == STREAM) // The 1-Wire time slots mask the interrupts long enough to lose received bytes
+    return;
+  
+  temp.startConversion();
+  scheduler.runIn(tempReadTask, temp.getConversionTime() / 2); // Sensors often finish early
+}
+
+void readTemp()
+{
+  if(!temp.update())
+  {
+    if(temp.isMeasuring()) // Conversion or reads still running
+      scheduler.runIn(tempReadTask, TEMP_POLL_INTERVAL);
+    
+    return;
+  }
+  
+  if(mode == TEMP)
+  {
+    if(autoModeChange) // Show each sensor in turn
+      temp.nextSensor();
+    
+    temp.displayTemp();
+    disp.display();
+  }
+}
+
+// Marquee mode : scroll by one column, start again once the text is gone (auto mode change moves on instead)
+void updateMarquee()
+{
+  if(mode != MARQUEE)
+    return;
+  
+  if(marquee.step())
+    disp.display();
+  else if(!autoModeChange)
+    startMarquee();
+}
+
+#ifdef SERIAL_STREAM
+// Stream mode : entered from the normal modes by the first frame received, left when the frames stop.
+// A text received scrolls on the marquee instead.
+void updateStream()
+{
+  char text[STREAM_MAX_TEXT + 1];
+  
+  if(stream.update() && mode != SETTINGS && mode != TIME_ADJUST && mode != BRIGHTNESS_ADJUST)
+  {
+    if(mode != STREAM)
+    {
+      mode = STREAM;
+      
+      animation.stop();
+      marquee.stop();
+    }
+    
+    streamFramePending = true;
+  }
+  
+  if(stream.getText(text) && mode != SETTINGS && mode != TIME_ADJUST && mode != BRIGHTNESS_ADJUST)
+  {
+    mode = MARQUEE;
+    
+    animation.stop();
+    disp.clear();
+    marquee.start(text, (DISPLAY_HEIGHT - FONT_HEIGHT) / 2);
+    disp.display();
+    
+    lastModeChange = millis();
+  }
+  
+  if(mode != STREAM)
+    return;
+  
+  // While the drivers still get the previous frame, the newer frames replace the pending one
+  if(streamFramePending && !disp.isBusy())
+  {
+    stream.present();
+    disp.display();
+    streamFramePending = false;
+  }
+  else if(millis() - stream.getLastFrameTime() >= STREAM_MODE_TIMEOUT)
+  {
+    mode = GOL;
+    
+    // The last frame is the base of the GOL
+    gol.resetStepCounter();
+    lastModeChange = millis();
+  }
+}
+#endif
+
+// Used to scroll the time, the date and the temperature across the middle of the display
+void startMarquee()
+{
+  char text[MARQUEE_MAX_LENGTH + 1];
+  
+  time.updateTime();
+  
+  time.getTimeText(text);
+  strcat(text, "  ");
+  time.getDateText(text + strlen(text));
+  
+  for(int i = 0 ; i < temp.getSensorCount() ; i++)
+  {
+    strcat(text, "  ");
+    temp.getTempText(text + strlen(text), i);
+  }
+  
+  marquee.start(text, (DISPLAY_HEIGHT - FONT_HEIGHT) / 2);
+}
+
+// Buttons and user interface : mode changes and settings
+void updateInputs()
 {
   // Refresh the inputs states
   inputs.updateButtonsStates();
   
-  // Update the brightness of the display
-  disp.updateBrightness();
+  // Animation playing : the modes wait for its end (any button skips it)
+  if(animation.isRunning())
+  {
+    if(inputs.getSinglePress(MODE) || inputs.getSinglePress(PLUS) || inputs.getSinglePress(MINUS))
+    {
+      animation.stop();
+      disp.clear();
+      disp.display();
+    }
+    else if(animation.update())
+      disp.display();
+    
+    return;
+  }
   
   // Auto mode change activation/desactivation
-  if((inputs.getSinglePress(PLUS) && inputs.getButtonState(MINUS) == HIGH) || (inputs.getSinglePress(MINUS) && inputs.getButtonState(PLUS) == HIGH))
+  if(inputs.getChord())
   {
     if(autoModeChange)
     {
@@ -75,10 +322,13 @@ void loop()
       autoModeChange = true;
       lastModeChange = millis(); // We do not want to change mode imediately
     }
+    
+    settings.setBooleanSetting(SETTING_AUTO_MODE_CHANGE, autoModeChange);
+    settings.save();
   }
   
   // Go to settings mode
-  if(mode != SETTINGS && inputs.getButtonState(MODE) == HIGH && millis() - inputs.getLastChangeTime(MODE) >= CONTINUOUS_PRESS_THRESHOLD)
+  if(mode != SETTINGS && inputs.getLongPress(MODE))
   {
     mode = SETTINGS;
     
@@ -108,10 +358,10 @@ void loop()
     disp.setLed(1, 12, true); disp.setLed(2, 12, true); disp.setLed(3, 12, true);
     
     // Scale
-    for(int i = 6 ; i < 14 ; i++)
+    for(int i = 6 ; i < 14 ; i++)
       disp.setLed(i, 13, true);
     
-    for(int i = 8 ; i < 14 ; i++)
+    for(int i = 8 ; i < 14 ; i++)
       disp.setLed(i, 12, true);
     
     for(int i = 10 ; i < 14 ; i++)
@@ -126,7 +376,7 @@ void loop()
   // ------------------------------- CHANGE MODE --------------------------------------------
   
   // Change mode
-  if(mode != SETTINGS && mode != TIME_ADJUST && mode != BRIGHTNESS_ADJUST && (inputs.getSinglePress(MODE) || (autoModeChange == true && millis() - lastModeChange >= modeDuration[mode])))
+  if(mode != SETTINGS && mode != TIME_ADJUST && mode != BRIGHTNESS_ADJUST && mode != STREAM && (inputs.getSinglePress(MODE) || (autoModeChange == true && (mode == MARQUEE ? !marquee.isRunning() : millis() - lastModeChange >= modeDuration[mode]))))
   {
     if(mode == GOL)
     {
@@ -152,17 +402,25 @@ void loop()
     {
       mode = TEMP;
       
-      temp.updateTemp();
-      
       disp.clear();
       temp.displayTemp();
       disp.display();
     }
     else if(mode == TEMP)
+    {
+      mode = MARQUEE;
+      
+      disp.clear();
+      startMarquee();
+      disp.display();
+    }
+    else if(mode == MARQUEE)
     {
       mode = GOL;
       
-      // We keep the live cells (= the temp digits) as a base for the GOL
+      marquee.stop();
+      
+      // We keep the live cells (= the scrolling text) as a base for the GOL
       gol.resetStepCounter();
       gol.getNextStep();
       disp.display();
@@ -175,52 +433,56 @@ void loop()
   
   // -------------------------- NORMAL MODES -------------------------------------
   
-  // Refresh the display according to the current mode
+  // User actions of the current mode (the refreshes are done by the tasks)
   if(mode == GOL)
   {
-    // Manual reset
-    if(inputs.getSinglePress(PLUS))
+    // Manual reset (on the release : held, PLUS toggles the toroidal world)
+    if(inputs.getShortPress(PLUS))
     {
         gol.initialize();
         disp.display();
     }
-        
-    if(gol.autoNextStep())
-    {
-      gol.autoReset(); // Auto reset (no more live cells or too much steps)
-      disp.display();
-    }
-  }
-  else if(mode == TIME)
-  {
-    // Display mode change
-    if(inputs.getSinglePress(PLUS))
+    
+    // Toroidal world on/off (not while MINUS is held : PLUS and MINUS together toggle the auto mode change)
+    if(inputs.getLongPress(PLUS) && !inputs.getButtonState(MINUS))
     {
-      time.changeTimeDisplayMode();
-      disp.clear();
-      time.displayTime();
-      disp.display();
+      gol.setWrap(!gol.getWrap());
+      settings.setBooleanSetting(SETTING_GOL_WRAP, gol.getWrap());
+      settings.save();
     }
     
-    if(time.updateTime())
+    // Next rule, on a new world (a long press : a single one may be the start of the PLUS and MINUS chord)
+    if(inputs.getLongPress(MINUS) && !inputs.getButtonState(PLUS))
     {
-      time.displayTime();
+      settings.setGolRule((settings.getGolRule() + 1) % GOL_RULE_PRESETS);
+      settings.save();
+      
+      gol.setRulePreset(settings.getGolRule());
+      gol.initialize();
       disp.display();
     }
   }
-  else if(mode == DATE)
+  else if(mode == TEMP)
   {
-    if(time.updateTime())
+    // Next sensor
+    if(inputs.getSinglePress(PLUS))
     {
-      time.displayDate();
+      temp.nextSensor();
+      temp.displayTemp();
       disp.display();
     }
   }
-  else if(mode == TEMP)
+  else if(mode == TIME)
   {
-    if(temp.updateTemp())
+    // Display mode change
+    if(inputs.getSinglePress(PLUS))
     {
-      temp.displayTemp();
+      time.changeTimeDisplayMode();
+      settings.setBooleanSetting(SETTING_CLOCK_DISPLAY_MODE, !settings.getBooleanSetting(SETTING_CLOCK_DISPLAY_MODE));
+      settings.save();
+      
+      disp.clear();
+      time.displayTime();
       disp.display();
     }
   }
@@ -246,7 +508,7 @@ void loop()
     {
       disp.display();
     }
-    else if(response == 2) // Time adjustment finished
+    else if(response == 2) // Time adjustment finished
     {
       disp.display();
       
@@ -0,0 +1,217 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * OneWireBus.cpp : Implements the OneWireBus class, which runs 1-Wire transactions (reset, bytes written,
+ * bytes read) in background : the Timer2 compare interrupt steps through the slots, so the main code
+ * only waits the few microseconds of each slot that are too short for the timer.
+ * Timer2 must not be used by anything else (tone() for example).
+ */
+
+#if defined(ARDUINO) && ARDUINO >= 100
+  #include <Arduino.h>
+#else
+  #include "WProgram.h"
+#endif
+
+#include <OneWire.h>
+
+#include "OneWireBus.h"
+
+// Lambda enumeration for the steps of the engine
+enum{ONEWIRE_IDLE, ONEWIRE_RESET_RELEASE, ONEWIRE_RESET_SAMPLE, ONEWIRE_SLOT, ONEWIRE_WRITE0_RELEASE};
+
+#if defined(__AVR__)
+// Bus driven by the timer interrupt
+static OneWireBus *timerBus = NULL;
+
+ISR(TIMER2_COMPA_vect)
+{
+  if(timerBus != NULL)
+    timerBus->timerInterrupt();
+}
+#endif
+
+// Constructor
+OneWireBus::OneWireBus(uint8_t pin, OneWire *wire)
+{
+  m_wire = wire;
+  m_pin = pin;
+  m_writeLength = 0;
+  m_readLength = 0;
+  m_busy = false;
+  m_presence = false;
+  m_phase = ONEWIRE_IDLE;
+  m_slot = 0;
+  m_pinIn = NULL;
+  m_pinOut = NULL;
+  m_pinMode = NULL;
+  m_pinMask = 0;
+}
+
+// Used to set up the pin and the timer, from setup() (init() reconfigures Timer2 after the constructors)
+void OneWireBus::begin()
+{
+  #if defined(__AVR__)
+    m_pinIn = portInputRegister(digitalPinToPort(m_pin));
+    m_pinOut = portOutputRegister(digitalPinToPort(m_pin));
+    m_pinMode = portModeRegister(digitalPinToPort(m_pin));
+    m_pinMask = digitalPinToBitMask(m_pin);
+    
+    // Released (the pull-up resistor keeps the bus high), low when set as an output
+    *m_pinMode &= ~m_pinMask;
+    *m_pinOut &= ~m_pinMask;
+    
+    // Timer2 in CTC mode, 2 us per tick at 16 MHz, interrupt enabled by waitTimer()
+    timerBus = this;
+    TIMSK2 &= ~_BV(OCIE2A);
+    TCCR2A = _BV(WGM21);
+    TCCR2B = _BV(CS21) | _BV(CS20);
+  #endif
+}
+
+// Used to start a transaction (after begin()) : an optional reset, writeLength bytes from data, then readLength bytes read
+// (see getData()). Returns false if a transaction is still running or the lengths are too long.
+boolean OneWireBus::start(const byte *data, byte writeLength, byte readLength, boolean reset)
+{
+  if(m_busy || writeLength > ONEWIRE_MAX_WRITE || readLength > ONEWIRE_MAX_READ)
+    return false;
+  
+  for(int i = 0 ; i < writeLength ; i++)
+    m_writeData[i] = data[i];
+  
+  for(int i = 0 ; i < readLength ; i++)
+    m_readData[i] = 0;
+  
+  m_writeLength = writeLength;
+  m_readLength = readLength;
+  m_presence = !reset;
+  m_slot = 0;
+  
+  #if defined(__AVR__)
+    m_busy = true;
+    *m_pinOut &= ~m_pinMask; // The blocking library may have left it high
+    
+    if(reset) // Reset pulse
+    {
+      *m_pinMode |= m_pinMask;
+      waitTimer(ONEWIRE_RESET_LOW, ONEWIRE_RESET_RELEASE);
+    }
+    else
+      waitTimer(ONEWIRE_WRITE0_END, ONEWIRE_SLOT);
+  #else
+    // No timer engine : the same transaction with the blocking library
+    if(reset)
+      m_presence = m_wire->reset();
+    
+    for(int i = 0 ; i < writeLength ; i++)
+      m_wire->write(m_writeData[i]);
+    
+    for(int i = 0 ; i < readLength ; i++)
+      m_readData[i] = m_wire->read();
+  #endif
+  
+  return true;
+}
+
+// Used to know if a transaction is running
+boolean OneWireBus::isBusy()
+{
+  return m_busy;
+}
+
+// Used to wait for the end of the running transaction
+void OneWireBus::waitIdle()
+{
+  while(m_busy)
+    ;
+}
+
+// Used to know if a device answered the reset of the last transaction
+boolean OneWireBus::getPresence()
+{
+  return m_presence;
+}
+
+// Used to get the bytes read by the last transaction
+const byte *OneWireBus::getData()
+{
+  return m_readData;
+}
+
+// Used to run the next step of the transaction in us microseconds
+void OneWireBus::waitTimer(unsigned int us, byte phase)
+{
+  m_phase = phase;
+  
+  #if defined(__AVR__)
+    OCR2A = (byte)(us * (F_CPU / 1000000UL) / 32UL - 1);
+    TCNT2 = 0;
+    TIFR2 = _BV(OCF2A);
+    TIMSK2 |= _BV(OCIE2A);
+  #else
+    (void)us;
+  #endif
+}
+
+// Timer2 interrupt : one step of the transaction. Only the short parts of the slots are busy waits.
+void OneWireBus::timerInterrupt()
+{
+  #if defined(__AVR__)
+    if(m_phase == ONEWIRE_RESET_RELEASE)
+    {
+      *m_pinMode &= ~m_pinMask;
+      waitTimer(ONEWIRE_PRESENCE_WAIT, ONEWIRE_RESET_SAMPLE);
+    }
+    else if(m_phase == ONEWIRE_RESET_SAMPLE)
+    {
+      m_presence = !(*m_pinIn & m_pinMask); // A device pulls the bus low
+      waitTimer(ONEWIRE_RESET_END, ONEWIRE_SLOT);
+    }
+    else if(m_phase == ONEWIRE_WRITE0_RELEASE)
+    {
+      *m_pinMode &= ~m_pinMask;
+      waitTimer(ONEWIRE_WRITE0_END, ONEWIRE_SLOT);
+    }
+    else if(m_phase == ONEWIRE_SLOT && m_slot < m_writeLength * 8U) // Write slot, LSB first
+    {
+      byte bit = m_writeData[m_slot >> 3] & (1 << (m_slot & 7));
+      
+      m_slot++;
+      *m_pinMode |= m_pinMask;
+      
+      if(bit)
+      {
+        delayMicroseconds(ONEWIRE_WRITE1_LOW);
+        *m_pinMode &= ~m_pinMask;
+        waitTimer(ONEWIRE_WRITE1_END, ONEWIRE_SLOT);
+      }
+      else
+        waitTimer(ONEWIRE_WRITE0_LOW, ONEWIRE_WRITE0_RELEASE);
+    }
+    else if(m_phase == ONEWIRE_SLOT && m_slot < (m_writeLength + m_readLength) * 8U) // Read slot, LSB first
+    {
+      unsigned int bit = m_slot - m_writeLength * 8U;
+      
+      m_slot++;
+      *m_pinMode |= m_pinMask;
+      delayMicroseconds(ONEWIRE_READ_LOW);
+      *m_pinMode &= ~m_pinMask;
+      delayMicroseconds(ONEWIRE_READ_SAMPLE);
+      
+      if(*m_pinIn & m_pinMask)
+        m_readData[bit >> 3] |= 1 << (bit & 7);
+      
+      waitTimer(ONEWIRE_READ_END, ONEWIRE_SLOT);
+    }
+    else // Transaction finished
+    {
+      TIMSK2 &= ~_BV(OCIE2A);
+      m_phase = ONEWIRE_IDLE;
+      m_busy = false;
+    }
+  #endif
+}
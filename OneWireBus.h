@@ -0,0 +1,66 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * OneWireBus.h : OneWireBus class definition.
+ */
+
+#ifndef DEF_ONEWIREBUS
+#define DEF_ONEWIREBUS
+
+#include <OneWire.h>
+
+#define ONEWIRE_MAX_WRITE 12 // Match ROM (9 bytes) plus a function command and its parameters
+#define ONEWIRE_MAX_READ 9 // A DS18B20 scratchpad
+
+// Slot timings (us), standard speed
+#define ONEWIRE_RESET_LOW 480
+#define ONEWIRE_PRESENCE_WAIT 70
+#define ONEWIRE_RESET_END 410
+#define ONEWIRE_WRITE1_LOW 6
+#define ONEWIRE_WRITE1_END 64
+#define ONEWIRE_WRITE0_LOW 60
+#define ONEWIRE_WRITE0_END 10
+#define ONEWIRE_READ_LOW 3
+#define ONEWIRE_READ_SAMPLE 10
+#define ONEWIRE_READ_END 53
+
+class OneWireBus
+{
+  public:
+    OneWireBus(uint8_t pin, OneWire *wire);
+    void begin();
+    boolean start(const byte *data, byte writeLength, byte readLength, boolean reset = true);
+    boolean isBusy();
+    void waitIdle();
+    boolean getPresence();
+    const byte *getData();
+  
+  private:
+    OneWire *m_wire; // Blocking fallback when there is no timer engine
+    byte m_writeData[ONEWIRE_MAX_WRITE];
+    byte m_readData[ONEWIRE_MAX_READ];
+    byte m_writeLength;
+    byte m_readLength;
+    volatile boolean m_busy;
+    volatile boolean m_presence;
+    
+    // Timer engine (Timer2), see timerInterrupt()
+    uint8_t m_pin;
+    volatile uint8_t *m_pinIn;
+    volatile uint8_t *m_pinOut;
+    volatile uint8_t *m_pinMode;
+    uint8_t m_pinMask;
+    volatile byte m_phase;
+    volatile unsigned int m_slot; // Bit being written or read
+    
+    void waitTimer(unsigned int us, byte phase);
+  
+  public:
+    void timerInterrupt(); // Called by the Timer2 interrupt
+};
+
+#endif
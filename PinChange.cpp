@@ -0,0 +1,86 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * PinChange.cpp : Dispatches the pin change interrupts to the handlers of the pins that actually changed.
+ */
+
+#if defined(ARDUINO) && ARDUINO >= 100
+  #include <Arduino.h>
+#else
+  #include "WProgram.h"
+#endif
+
+#include "PinChange.h"
+
+static uint8_t pinChangePins[PIN_CHANGE_HANDLERS];
+static PinChangeHandler pinChangeHandlers[PIN_CHANGE_HANDLERS];
+static byte pinChangeCount = 0;
+static volatile byte pinChangeLevels = 0; // Last level of each pin, one bit per handler
+
+// Several pins share a vector : call the handlers of those whose level changed
+static void pinChangeInterrupt()
+{
+  for(byte i = 0 ; i < pinChangeCount ; i++)
+  {
+    byte level = digitalRead(pinChangePins[i]) == HIGH ? 1 << i : 0;
+    
+    if(level != (pinChangeLevels & (1 << i)))
+    {
+      pinChangeLevels ^= 1 << i;
+      pinChangeHandlers[i]();
+    }
+  }
+}
+
+#if defined(PCICR)
+ISR(PCINT0_vect)
+{
+  pinChangeInterrupt();
+}
+
+ISR(PCINT1_vect)
+{
+  pinChangeInterrupt();
+}
+
+ISR(PCINT2_vect)
+{
+  pinChangeInterrupt();
+}
+#endif
+
+// Used to run a handler on each change of a pin. Returns false if the pin has no pin change interrupt
+// or if PIN_CHANGE_HANDLERS handlers are already attached.
+boolean attachPinChange(uint8_t pin, PinChangeHandler handler)
+{
+  #if defined(PCICR)
+    if(pinChangeCount == PIN_CHANGE_HANDLERS || digitalPinToPCICR(pin) == 0)
+      return false;
+    
+    noInterrupts();
+    
+    pinChangePins[pinChangeCount] = pin;
+    pinChangeHandlers[pinChangeCount] = handler;
+    
+    if(digitalRead(pin) == HIGH)
+      pinChangeLevels |= 1 << pinChangeCount;
+    
+    pinChangeCount++;
+    
+    *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+    *digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
+    
+    interrupts();
+    
+    return true;
+  #else
+    (void)pin;
+    (void)handler;
+    
+    return false;
+  #endif
+}
@@ -0,0 +1,30 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * PinChange.h : Pin change interrupts shared by the modules (one vector per port on the ATmega328).
+ */
+
+#ifndef DEF_PINCHANGE
+#define DEF_PINCHANGE
+
+#define PIN_CHANGE_HANDLERS 4
+
+// Older cores do not map the pins to their external interrupt
+#ifndef NOT_AN_INTERRUPT
+  #define NOT_AN_INTERRUPT -1
+#endif
+
+#ifndef digitalPinToInterrupt
+  #define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+#endif
+
+// Called from the interrupt each time the level of the pin changes
+typedef void (*PinChangeHandler)();
+
+boolean attachPinChange(uint8_t pin, PinChangeHandler handler);
+
+#endif
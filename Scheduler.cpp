@@ -0,0 +1,181 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * Scheduler.cpp : Implements the Scheduler class, a cooperative scheduler running periodic and one-shot tasks at their deadlines.
+ */
+
+#if defined(ARDUINO) && ARDUINO >= 100
+  #include <Arduino.h>
+#else
+  #include "WProgram.h"
+#endif
+
+#if defined(__AVR__)
+  #include <avr/sleep.h>
+#endif
+
+#include "Scheduler.h"
+
+// Constructor
+Scheduler::Scheduler()
+{
+  m_taskAmount = 0;
+}
+
+// Used to register a task. A period of 0 makes a one-shot task, started with runIn().
+// The first run of an enabled periodic task is due immediately. Returns the task id, or SCHEDULER_NO_TASK if full.
+byte Scheduler::addTask(TaskFunction function, unsigned long period, boolean enabled)
+{
+  if(m_taskAmount == SCHEDULER_MAX_TASKS)
+    return SCHEDULER_NO_TASK;
+  
+  byte task = m_taskAmount++;
+  
+  m_function[task] = function;
+  m_period[task] = period;
+  m_deadline[task] = millis();
+  m_enabled[task] = enabled && period != 0UL;
+  m_overruns[task] = 0U;
+  m_maxLateness[task] = 0UL;
+  
+  return task;
+}
+
+// Used to change the period of a task (applies from its next run)
+void Scheduler::setPeriod(byte task, unsigned long period)
+{
+  if(task < m_taskAmount)
+    m_period[task] = period;
+}
+
+// Used to enable a task and make it due in delay ms
+void Scheduler::runIn(byte task, unsigned long delay)
+{
+  if(task >= m_taskAmount)
+    return;
+  
+  m_deadline[task] = millis() + delay;
+  m_enabled[task] = true;
+}
+
+// Used to enable a task, due immediately
+void Scheduler::enable(byte task)
+{
+  if(task < m_taskAmount && !m_enabled[task])
+    runIn(task, 0UL);
+}
+
+// Used to disable a task
+void Scheduler::disable(byte task)
+{
+  if(task < m_taskAmount)
+    m_enabled[task] = false;
+}
+
+// Used to run the tasks that are due, earliest deadline first. Returns true if a task ran.
+boolean Scheduler::run()
+{
+  boolean ran = false;
+  
+  while(true)
+  {
+    unsigned long now = millis();
+    byte next = SCHEDULER_NO_TASK;
+    
+    // Find the most overdue task
+    for(byte i = 0 ; i < m_taskAmount ; i++)
+    {
+      if(m_enabled[i] && (long)(now - m_deadline[i]) >= 0 && (next == SCHEDULER_NO_TASK || (long)(m_deadline[i] - m_deadline[next]) < 0))
+        next = i;
+    }
+    
+    if(next == SCHEDULER_NO_TASK) // Nothing else is due
+      return ran;
+    
+    // Lateness statistics
+    unsigned long lateness = now - m_deadline[next];
+    
+    m_maxLateness[next] = max(m_maxLateness[next], lateness);
+    
+    // Next deadline (before running the task, which may change it)
+    if(m_period[next] == 0UL) // One-shot
+      m_enabled[next] = false;
+    else if(lateness >= m_period[next]) // A whole period was missed : skip it rather than bunching the runs
+    {
+      m_overruns[next]++;
+      m_deadline[next] = now + m_period[next];
+    }
+    else
+      m_deadline[next] += m_period[next];
+    
+    m_function[next]();
+    ran = true;
+  }
+}
+
+// Used to get the earliest deadline of the enabled tasks (now + 1 s if there is none)
+unsigned long Scheduler::getNextDeadline()
+{
+  unsigned long now = millis();
+  unsigned long deadline = now + 1000UL;
+  
+  for(byte i = 0 ; i < m_taskAmount ; i++)
+  {
+    if(m_enabled[i] && (long)(m_deadline[i] - deadline) < 0)
+      deadline = m_deadline[i];
+  }
+  
+  return deadline;
+}
+
+// Used to idle the CPU until the earliest deadline (any interrupt wakes it up in between)
+void Scheduler::idle()
+{
+  unsigned long deadline = getNextDeadline();
+  
+  #if defined(__AVR__)
+    set_sleep_mode(SLEEP_MODE_IDLE); // Timers keep running : millis() wakes us up every ms
+    
+    while((long)(deadline - millis()) > 0)
+    {
+      sleep_enable();
+      sleep_cpu();
+      sleep_disable();
+    }
+  #else
+    long wait = (long)(deadline - millis());
+    
+    if(wait > 0)
+      delay(wait);
+  #endif
+}
+
+// Used to get the number of periods a task missed
+unsigned int Scheduler::getOverruns(byte task)
+{
+  return task < m_taskAmount ? m_overruns[task] : 0U;
+}
+
+// Used to get the worst delay (ms) between the deadline of a task and its run
+unsigned long Scheduler::getMaxLateness(byte task)
+{
+  return task < m_taskAmount ? m_maxLateness[task] : 0UL;
+}
+
+// ---------- Debuging functions ---------------
+
+// Used to print the statistics of each task
+#ifdef DEBUG
+void Scheduler::printStats()
+{
+  for(byte i = 0 ; i < m_taskAmount ; i++)
+  {
+    Serial.println("Task #" + String(i) + " : period " + String(m_period[i]) + " ms, "
+      + String(m_overruns[i]) + " overruns, max lateness " + String(m_maxLateness[i]) + " ms");
+  }
+}
+#endif
@@ -0,0 +1,50 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * Scheduler.h : Scheduler class definition.
+ */
+
+#ifndef DEF_SCHEDULER
+#define DEF_SCHEDULER
+
+#define SCHEDULER_MAX_TASKS 8
+#define SCHEDULER_NO_TASK 0xFF
+
+typedef void (*TaskFunction)();
+
+class Scheduler
+{
+  public:
+    Scheduler();
+    byte addTask(TaskFunction function, unsigned long period, boolean enabled = true);
+    void setPeriod(byte task, unsigned long period);
+    void runIn(byte task, unsigned long delay);
+    void enable(byte task);
+    void disable(byte task);
+    boolean run();
+    void idle();
+    unsigned long getNextDeadline();
+    unsigned int getOverruns(byte task);
+    unsigned long getMaxLateness(byte task);
+    
+    #ifdef DEBUG
+      void printStats();
+    #endif
+  
+  private:
+    // One entry per task
+    TaskFunction m_function[SCHEDULER_MAX_TASKS];
+    unsigned long m_period[SCHEDULER_MAX_TASKS]; // ms, 0 = one-shot
+    unsigned long m_deadline[SCHEDULER_MAX_TASKS];
+    boolean m_enabled[SCHEDULER_MAX_TASKS];
+    unsigned int m_overruns[SCHEDULER_MAX_TASKS];
+    unsigned long m_maxLateness[SCHEDULER_MAX_TASKS];
+    
+    byte m_taskAmount;
+};
+
+#endif
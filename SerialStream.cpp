@@ -0,0 +1,265 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * SerialStream.cpp : Implements the SerialStream class, which receives frames sent over the serial port
+ * (see SerialStream.h). update() parses whatever the serial receive buffer holds without ever waiting, and
+ * decodes the frame into a back buffer as it arrives : the display only gets a frame once it is complete
+ * and its CRC is right, so it never shows half of one. The texts are kept for the marquee (see getText()).
+ */
+
+#if defined(ARDUINO) && ARDUINO >= 100
+  #include <Arduino.h>
+#else
+  #include "WProgram.h"
+#endif
+
+#include <util/crc16.h>
+
+#include "SerialStream.h"
+#include "Display.h"
+
+// Constructor
+SerialStream::SerialStream(Display *disp)
+{
+  m_disp = disp;
+  m_front = 0;
+  m_synced = false;
+  m_sequence = 0;
+  m_text[0] = '\0';
+  m_textPending = false;
+  
+  m_state = STREAM_WAIT_SYNC_1;
+  m_index = 0;
+  m_remaining = 0;
+  m_run = 0;
+  m_valid = false;
+  m_crc = 0;
+  m_lastByteTime = 0UL;
+  
+  m_lastFrameTime = 0UL;
+  m_frameCount = 0UL;
+  m_errorCount = 0;
+  
+  memset(m_frames, 0, sizeof(m_frames));
+}
+
+// Used to open the serial port, from setup()
+void SerialStream::begin(unsigned long baud)
+{
+  Serial.begin(baud);
+}
+
+// Used to parse the received bytes. Returns true if a new frame is complete (see present()).
+boolean SerialStream::update()
+{
+  boolean complete = false;
+  
+  while(Serial.available() > 0)
+  {
+    m_lastByteTime = millis();
+    
+    if(parse(Serial.read()))
+      complete = true;
+  }
+  
+  // The sender went away in the middle of a packet : look for the next one
+  if(m_state != STREAM_WAIT_SYNC_1 && millis() - m_lastByteTime > STREAM_BYTE_TIMEOUT)
+  {
+    m_state = STREAM_WAIT_SYNC_1;
+    m_errorCount++;
+  }
+  
+  return complete;
+}
+
+// Used to draw the last complete frame into the display buffer
+void SerialStream::present()
+{
+  for(int i = 0 ; i < ANIMATION_FRAME_BYTES ; i++)
+    m_disp->drawByte(i % DISPLAY_BLOCKS_X, i / DISPLAY_BLOCKS_X, m_frames[m_front][i]);
+}
+
+// Used to get the last text received (text : STREAM_MAX_TEXT + 1 characters), once. Returns false if there is none.
+boolean SerialStream::getText(char *text)
+{
+  if(!m_textPending)
+    return false;
+  
+  strcpy(text, m_text);
+  m_textPending = false;
+  
+  return true;
+}
+
+// Used to get the time (millis()) of the last complete frame
+unsigned long SerialStream::getLastFrameTime()
+{
+  return m_lastFrameTime;
+}
+
+// Used to get the number of frames received
+unsigned long SerialStream::getFrameCount()
+{
+  return m_frameCount;
+}
+
+// Used to get the number of packets dropped (wrong CRC, header or payload, lost delta base, timeout)
+unsigned int SerialStream::getErrorCount()
+{
+  return m_errorCount;
+}
+
+// Used to feed the parser with one byte. Returns true if it completed a frame.
+boolean SerialStream::parse(byte data)
+{
+  switch(m_state)
+  {
+    case STREAM_WAIT_SYNC_1:
+      if(data == STREAM_SYNC_1)
+        m_state = STREAM_WAIT_SYNC_2;
+      
+      return false;
+    
+    case STREAM_WAIT_SYNC_2:
+      if(data == STREAM_SYNC_2)
+      {
+        m_state = STREAM_HEADER;
+        m_index = 0;
+        m_crc = 0;
+      }
+      else if(data != STREAM_SYNC_1)
+        m_state = STREAM_WAIT_SYNC_1;
+      
+      return false;
+    
+    case STREAM_HEADER:
+      m_crc = _crc_ibutton_update(m_crc, data);
+      m_header[m_index++] = data;
+      
+      if(m_index < sizeof(m_header))
+        return false;
+      
+      m_remaining = m_header[2] | (m_header[3] << 8);
+      
+      if(m_header[1] == STREAM_TEXT ? m_remaining > STREAM_MAX_TEXT :
+        m_remaining > STREAM_MAX_PAYLOAD || (m_header[1] != ANIMATION_KEYFRAME && m_header[1] != ANIMATION_DELTA))
+      {
+        m_state = STREAM_WAIT_SYNC_1; // Not a header after all
+        m_errorCount++;
+        return false;
+      }
+      
+      startPayload();
+      m_state = m_remaining > 0 ? STREAM_PAYLOAD : STREAM_CRC;
+      return false;
+    
+    case STREAM_PAYLOAD:
+      m_crc = _crc_ibutton_update(m_crc, data);
+      
+      if(m_valid)
+        decode(data);
+      
+      if(--m_remaining == 0)
+        m_state = STREAM_CRC;
+      
+      return false;
+    
+    default: // STREAM_CRC
+      m_state = STREAM_WAIT_SYNC_1;
+      
+      if(m_header[1] == STREAM_TEXT)
+      {
+        if(data != m_crc)
+          m_errorCount++;
+        else
+        {
+          m_text[m_index] = '\0';
+          m_textPending = true;
+        }
+        
+        return false;
+      }
+      
+      if(data != m_crc || !m_valid || m_index != ANIMATION_FRAME_BYTES || m_run != 0)
+      {
+        m_errorCount++;
+        return false;
+      }
+      
+      // The back buffer becomes the frame to show
+      m_front ^= 1;
+      m_sequence = m_header[0];
+      m_synced = true;
+      m_lastFrameTime = millis();
+      m_frameCount++;
+      return true;
+  }
+}
+
+// Used to prepare the back buffer for the payload described by the header
+void SerialStream::startPayload()
+{
+  m_index = 0;
+  m_run = 0;
+  
+  if(m_header[1] == STREAM_TEXT) // Replaces the text not read yet, if any
+    m_textPending = false;
+  
+  if(m_header[1] == ANIMATION_KEYFRAME || m_header[1] == STREAM_TEXT)
+  {
+    m_valid = true;
+    return;
+  }
+  
+  // A delta needs the frame it was made from
+  m_valid = m_synced && m_header[0] == (byte)(m_sequence + 1);
+  
+  if(m_valid)
+    memcpy(m_frames[m_front ^ 1], m_frames[m_front], ANIMATION_FRAME_BYTES);
+}
+
+// Used to decode one payload byte into the back buffer
+void SerialStream::decode(byte data)
+{
+  byte *frame = m_frames[m_front ^ 1];
+  
+  if(m_header[1] == STREAM_TEXT) // At most STREAM_MAX_TEXT bytes (see parse())
+  {
+    m_text[m_index++] = data;
+    return;
+  }
+  
+  if(m_header[1] == ANIMATION_KEYFRAME || m_run > 0)
+  {
+    if(m_index >= ANIMATION_FRAME_BYTES)
+    {
+      m_valid = false;
+      return;
+    }
+    
+    if(m_header[1] == ANIMATION_KEYFRAME)
+      frame[m_index++] = data;
+    else
+    {
+      frame[m_index++] ^= data;
+      m_run--;
+    }
+    
+    return;
+  }
+  
+  // Start of a run
+  unsigned int length = (data & ~ANIMATION_RUN_XOR) + 1;
+  
+  if(data & ANIMATION_RUN_XOR)
+    m_run = length;
+  else
+    m_index += length; // Unchanged bytes
+  
+  if(m_index + m_run > ANIMATION_FRAME_BYTES)
+    m_valid = false;
+}
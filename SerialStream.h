@@ -0,0 +1,89 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * SerialStream.h : SerialStream class definition.
+ */
+
+#ifndef DEF_SERIALSTREAM
+#define DEF_SERIALSTREAM
+
+#include "Display.h"
+#include "Animation.h"
+#include "Marquee.h"
+
+/* ========== STREAM PACKETS ==========
+ *
+ * Sent by sim/streamsend, one per frame :
+ *
+ * Bytes 0-1 : STREAM_SYNC_1, STREAM_SYNC_2
+ * Byte 2 : Sequence number (incremented for each frame)
+ * Byte 3 : Type (ANIMATION_KEYFRAME, ANIMATION_DELTA or STREAM_TEXT)
+ * Bytes 4-5 : Length of the payload (little endian, STREAM_MAX_PAYLOAD at most, STREAM_MAX_TEXT for a text)
+ * Payload : encoded like the frames of the animations (see Animation.h), a delta applying to the frame
+ *   of the previous sequence number. For a text, its characters, to scroll on the marquee.
+ * Last byte : CRC-8 (Dallas/Maxim) of bytes 2 to the end of the payload
+ *
+ * A delta is only applied on top of the frame it was made from : after a lost packet, the frames are
+ * dropped until the next keyframe. A text leaves the frames and their sequence numbers as they are.
+ *
+ */
+
+#define STREAM_SYNC_1 0xA5
+#define STREAM_SYNC_2 0x5A
+#define STREAM_MAX_PAYLOAD ANIMATION_FRAME_BYTES // The sender uses a keyframe when the delta is not smaller
+#define STREAM_TEXT 0x03 // Type of a text packet, after the frame types of Animation.h
+#define STREAM_MAX_TEXT MARQUEE_MAX_LENGTH
+#define STREAM_BYTE_TIMEOUT 20UL // ms, a packet stalled longer than this is dropped
+
+// Lambda enumeration for the state of the parser
+enum{STREAM_WAIT_SYNC_1, STREAM_WAIT_SYNC_2, STREAM_HEADER, STREAM_PAYLOAD, STREAM_CRC};
+
+class SerialStream
+{
+  public:
+    SerialStream(Display *disp);
+    void begin(unsigned long baud);
+    boolean update();
+    void present();
+    boolean getText(char *text);
+    unsigned long getLastFrameTime();
+    unsigned long getFrameCount();
+    unsigned int getErrorCount();
+  
+  private:
+    Display *m_disp;
+    
+    // Last complete frame, and the one being received
+    byte m_frames[2][ANIMATION_FRAME_BYTES];
+    byte m_front;
+    boolean m_synced; // m_frames[m_front] is the frame of m_sequence
+    byte m_sequence;
+    
+    // Last text received, until getText()
+    char m_text[STREAM_MAX_TEXT + 1];
+    boolean m_textPending;
+    
+    // Parser
+    byte m_state;
+    byte m_header[4];
+    unsigned int m_index; // Header byte, or frame byte being decoded
+    unsigned int m_remaining; // Payload bytes left
+    byte m_run; // Bytes left in the current XOR run
+    boolean m_valid; // Payload consistent so far
+    byte m_crc;
+    unsigned long m_lastByteTime;
+    
+    unsigned long m_lastFrameTime;
+    unsigned long m_frameCount;
+    unsigned int m_errorCount;
+    
+    boolean parse(byte data);
+    void startPayload();
+    void decode(byte data);
+};
+
+#endif
@@ -28,24 +28,58 @@ SettingsHandler::SettingsHandler(Display *disp, InputHandler *inputs)
   m_disp = disp;
   m_inputs = inputs;
   
-  for(int i = 0 ; i++ ; i < 5)
+  m_record = SETTINGS_LOG_RECORDS - 1; // The first record is written at the start of the log
+  m_sequence = 0xFF;
+  
+  setDefaults();
+  
+  for(int i = 0 ; i < SETTINGS_LENGTH ; i++)
   {
-    m_settings[i] = 0;
+    m_savedSettings[i] = m_settings[i];
   }
-  
-  /*EEPROM.write(0, 30);
-  EEPROM.write(1, 30);
-  EEPROM.write(2, 30);
-  EEPROM.write(3, 30);
-  EEPROM.write(4, B00000000);*/
 }
 
-// Used to get the settings from the EEPROM
+// Used to get the settings from the EEPROM : the newest valid record of the log. If there is none, the settings of
+// the former layout (bytes 0 to 4, rewritten in place) are moved to the log, else the defaults are used.
 void SettingsHandler::read()
 {
-  for(int i = 0 ; i < 5 ; i++)
+  byte settings[SETTINGS_LENGTH];
+  byte sequence;
+  boolean found = false;
+  
+  for(byte i = 0 ; i < SETTINGS_LOG_RECORDS ; i++)
+  {
+    // The log spans less than 128 sequence numbers : the difference tells which record is newer
+    if(readRecord(i, settings, &sequence) && (!found || (signed char)(sequence - m_sequence) > 0))
+    {
+      for(int j = 0 ; j < SETTINGS_LENGTH ; j++)
+      {
+        m_settings[j] = settings[j];
+      }
+      
+      m_record = i;
+      m_sequence = sequence;
+      found = true;
+    }
+  }
+  
+  if(!found) // Former layout, fresh or corrupted EEPROM
+  {
+    m_record = SETTINGS_LOG_RECORDS - 1;
+    m_sequence = 0xFF;
+    
+    if(readLegacy())
+    {
+      writeRecord(); // Once : the first record overwrites the former layout
+      return;
+    }
+    
+    setDefaults();
+  }
+  
+  for(int i = 0 ; i < SETTINGS_LENGTH ; i++)
   {
-    m_settings[i] = EEPROM.read(i);
+    m_savedSettings[i] = m_settings[i];
   }
 }
 
@@ -64,12 +98,159 @@ boolean SettingsHandler::getBooleanSetting(int setting)
   return m_settings[4] & (B00000001 << setting) ? true : false;
 }
 
-// Used to write the settings to the EEPROM memory
+// Used to change a boolean setting (see save())
+void SettingsHandler::setBooleanSetting(int setting, boolean value)
+{
+  if(value)
+    m_settings[4] |= B00000001 << setting;
+  else
+    m_settings[4] &= ~(B00000001 << setting);
+}
+
+// Used to read the GOL rule (a preset of GameOfLife)
+byte SettingsHandler::getGolRule()
+{
+  return m_settings[4] >> SETTINGS_GOL_RULE_SHIFT;
+}
+
+// Used to change the GOL rule (see save())
+void SettingsHandler::setGolRule(byte rule)
+{
+  m_settings[4] = (m_settings[4] & ~(B11111111 << SETTINGS_GOL_RULE_SHIFT)) | (rule << SETTINGS_GOL_RULE_SHIFT);
+}
+
+// Used to write the settings to the EEPROM memory, as the next record of the log. Nothing is written if they did not change.
 void SettingsHandler::save()
 {
-  for(int i = 0 ; i < 5 ; i++)
+  boolean changed = false;
+  
+  for(int i = 0 ; i < SETTINGS_LENGTH ; i++)
+  {
+    if(m_settings[i] != m_savedSettings[i])
+      changed = true;
+  }
+  
+  if(changed)
+    writeRecord();
+}
+
+// Used to append the settings to the log
+void SettingsHandler::writeRecord()
+{
+  byte record[SETTINGS_RECORD_SIZE];
+  byte crc = 0;
+  
+  m_record = (m_record + 1) % SETTINGS_LOG_RECORDS;
+  m_sequence++;
+  
+  record[0] = m_sequence;
+  record[1] = SETTINGS_VERSION;
+  
+  for(int i = 0 ; i < SETTINGS_LENGTH ; i++)
+  {
+    record[i + 2] = m_settings[i];
+    m_savedSettings[i] = m_settings[i];
+  }
+  
+  for(int i = 0 ; i < SETTINGS_RECORD_SIZE - 1 ; i++)
+  {
+    crc = crc8(crc, record[i]);
+  }
+  
+  record[SETTINGS_RECORD_SIZE - 1] = crc; // Written last : the record is not valid until it is complete
+  
+  // The previous records are left untouched, so an interrupted write falls back to the last one
+  int address = SETTINGS_LOG_START + m_record * SETTINGS_RECORD_SIZE;
+  
+  for(int i = 0 ; i < SETTINGS_RECORD_SIZE ; i++)
   {
-    EEPROM.write(i, m_settings[i]);
+    if(EEPROM.read(address + i) != record[i]) // Do not wear the cells that already hold the right value
+      EEPROM.write(address + i, record[i]);
   }
 }
 
+// Used to set the settings used when the EEPROM holds no valid record
+void SettingsHandler::setDefaults()
+{
+  for(int i = 0 ; i < 4 ; i++)
+  {
+    m_settings[i] = SETTINGS_DEFAULT_DURATION;
+  }
+  
+  m_settings[4] = B00000000;
+}
+
+// Used to read the settings of the former layout. Returns false if they are out of range (fresh EEPROM, or something else).
+boolean SettingsHandler::readLegacy()
+{
+  byte settings[SETTINGS_LENGTH];
+  
+  for(int i = 0 ; i < SETTINGS_LENGTH ; i++)
+  {
+    settings[i] = EEPROM.read(SETTINGS_LEGACY_START + i);
+  }
+  
+  for(int i = 0 ; i < 4 ; i++)
+  {
+    if(settings[i] == 0 || settings[i] == 0xFF) // Mode durations, 0xFF for an erased cell
+      return false;
+  }
+  
+  if(settings[4] & ~SETTINGS_LEGACY_BOOLEANS)
+    return false;
+  
+  for(int i = 0 ; i < SETTINGS_LENGTH ; i++)
+  {
+    m_settings[i] = settings[i];
+  }
+  
+  return true;
+}
+
+// Used to read a record of the log. Returns false if its CRC or its version are wrong.
+boolean SettingsHandler::readRecord(byte record, byte *settings, byte *sequence)
+{
+  byte data[SETTINGS_RECORD_SIZE];
+  byte crc = 0;
+  int address = SETTINGS_LOG_START + record * SETTINGS_RECORD_SIZE;
+  
+  for(int i = 0 ; i < SETTINGS_RECORD_SIZE ; i++)
+  {
+    data[i] = EEPROM.read(address + i);
+  }
+  
+  for(int i = 0 ; i < SETTINGS_RECORD_SIZE - 1 ; i++)
+  {
+    crc = crc8(crc, data[i]);
+  }
+  
+  if(crc != data[SETTINGS_RECORD_SIZE - 1] || data[1] != SETTINGS_VERSION)
+    return false;
+  
+  *sequence = data[0];
+  
+  for(int i = 0 ; i < SETTINGS_LENGTH ; i++)
+  {
+    settings[i] = data[i + 2];
+  }
+  
+  return true;
+}
+
+// Used to add a byte to a CRC-8 (Dallas/Maxim polynomial, the one of the 1-Wire devices)
+byte SettingsHandler::crc8(byte crc, byte data)
+{
+  for(int i = 0 ; i < 8 ; i++)
+  {
+    byte mix = (crc ^ data) & 0x01;
+    
+    crc >>= 1;
+    
+    if(mix)
+      crc ^= 0x8C;
+    
+    data >>= 1;
+  }
+  
+  return crc;
+}
@@ -23,17 +23,41 @@
  * Byte 3 : Temperature mode duration (seconds)
  *
  * Byte 4 :
- *   Bit 0 (LSB) : Auto mode change (disabled : 0 / enabled : 1)
+ *   Bit 0 (LSB) : Auto mode change (disabled : 0 / enabled : 1)
  *   Bit 1 : Clock display mode (normal : 0 / binary : 1)
  *   Bit 2 : Auto clock display mode change (disabled : 0 / enabled : 1)
+ *   Bit 4 : GOL world (dead edges : 0 / torus : 1)
+ *   Bits 5 to 7 : GOL rule (preset of GameOfLife, 0 : B3/S23)
+ *
+ * Each save() appends a record to a log of SETTINGS_LOG_RECORDS records, from SETTINGS_LOG_START,
+ * so that each cell is only written once every SETTINGS_LOG_RECORDS saves :
+ *
+ * Byte 0 : Sequence number (the newest valid record holds the settings)
+ * Byte 1 : SETTINGS_VERSION
+ * Bytes 2 to 6 : Settings
+ * Byte 7 : CRC-8 of bytes 0 to 6
+ *
+ * The former layout held the settings alone in bytes 0 to 4, with only bits 0 to 3 of byte 4 used : read() moves
+ * them to the log if it holds no valid record.
  *
  */
  
+#define SETTINGS_LENGTH 5
+#define SETTINGS_VERSION 1
+#define SETTINGS_RECORD_SIZE (SETTINGS_LENGTH + 3)
+#define SETTINGS_LOG_START 0
+#define SETTINGS_LOG_RECORDS 64 // Less than 128, for the comparison of the sequence numbers
+#define SETTINGS_DEFAULT_DURATION 30 // seconds
+#define SETTINGS_LEGACY_START 0 // Settings of the former layout
+#define SETTINGS_LEGACY_BOOLEANS B00001111 // Bits of byte 4 used by the former layout
 
 // Boolean settings bits definitions 
 #define SETTING_AUTO_MODE_CHANGE                0
 #define SETTING_CLOCK_DISPLAY_MODE              1
 #define SETTING_AUTO_CLOCK_DISPLAY_MODE_CHANGE  3
+#define SETTING_GOL_WRAP                        4
+
+#define SETTINGS_GOL_RULE_SHIFT 5 // Bits of the GOL rule in byte 4
 
 class SettingsHandler
 {
@@ -42,15 +66,26 @@ class SettingsHandler
     void read();
     void getModeDurations(unsigned int modeDurations[]);
     boolean getBooleanSetting(int setting);
+    void setBooleanSetting(int setting, boolean value);
+    byte getGolRule();
+    void setGolRule(byte rule);
     
     void save();
   
   private:
-    byte m_settings[5];
+    byte m_settings[SETTINGS_LENGTH];
+    byte m_savedSettings[SETTINGS_LENGTH]; // Content of the newest record
+    byte m_record; // Newest record of the log
+    byte m_sequence;
     
     Display *m_disp;
     InputHandler *m_inputs;
+    
+    void setDefaults();
+    void writeRecord();
+    boolean readLegacy();
+    boolean readRecord(byte record, byte *settings, byte *sequence);
+    static byte crc8(byte crc, byte data);
 };
 
 #endif
- 
@@ -5,7 +5,7 @@
  * http://op414.net
  * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
  * ---------
- * TempSensor.cpp : Implements the TempSensor class which is used to interract with the DS18B20 temperature sensor.
+ * TempSensor.cpp : Implements the TempSensor class which is used to interract with the DS18B20 temperature sensors.
  */
  
 #if defined(ARDUINO) && ARDUINO >= 100
@@ -18,88 +18,258 @@
 
 #include "TempSensor.h"
 #include "Display.h"
+#include "OneWireBus.h"
 #include "settings.h"
 
+// Lambda enumeration for the steps of a measurement
+enum{TEMP_IDLE, TEMP_CONVERTING, TEMP_POLLING, TEMP_READING};
+
 // Constructor
-TempSensor::TempSensor(Display *disp) : m_sensor(PIN_TEMP)
+TempSensor::TempSensor(Display *disp) : m_sensor(PIN_TEMP), m_bus(PIN_TEMP, &m_sensor)
 {
+  static const int offsets[TEMP_MAX_SENSORS] = TEMP_SENSOR_OFFSETS;
+  
   m_disp = disp;
-  m_tempWhole = 0;
-  m_tempFract = 0;
-  m_conversionAsked = false;
+  m_sensorCount = 0;
+  m_displayedSensor = 0;
+  m_resolution = TEMP_RESOLUTION;
+  m_readErrors = 0;
+  m_state = TEMP_IDLE;
+  m_readSensor = 0;
+  m_readDone = false;
+  
+  for(int i = 0 ; i < TEMP_MAX_SENSORS ; i++)
+  {
+    m_temps[i] = 0;
+    m_offsets[i] = offsets[i];
+  }
 }
 
-// Used to ask the sensor to start computing the temperature
-void TempSensor::startConversion()
+// Used to find the DS18B20 on the bus (ROM search), up to TEMP_MAX_SENSORS
+void TempSensor::initializeSensors()
 {
-  m_sensor.reset(); // Reset bus
-  m_sensor.skip(); // Skip the device selection (only one sensor is on the bus)
-  m_sensor.write(DS18B20_START_CONVERSION); // Ask to start conversion
+  byte address[8];
   
-  m_conversionStartTime = millis();
-}
+  m_sensorCount = 0;
+  m_sensor.reset_search();
   
-// Used to update the temp
-boolean TempSensor::updateTemp()
-{
-  if(millis() - m_conversionStartTime >= TEMP_CHECK_INTERVAL || m_conversionStartTime == 0) // Begin a new conversion
+  while(m_sensorCount < TEMP_MAX_SENSORS && m_sensor.search(address))
   {
-    startConversion();
-    m_conversionStartTime = millis();
-    m_conversionAsked = true;
+    if(address[0] != DS18B20_FAMILY || OneWire::crc8(address, 7) != address[7]) // Other device or corrupted ROM code
+      continue;
+    
+    for(int i = 0 ; i < 8 ; i++)
+      m_addresses[m_sensorCount][i] = address[i];
     
-    return false; // Temp did not changed
+    m_sensorCount++;
   }
-  else if(millis() - m_conversionStartTime >= TEMP_CONVERSION_DELAY && m_conversionAsked == true) // Read the temp
+  
+  m_displayedSensor = 0;
+  
+  m_bus.begin();
+  setResolution(m_resolution);
+}
+
+// Used to get the number of sensors found by initializeSensors()
+byte TempSensor::getSensorCount()
+{
+  return m_sensorCount;
+}
+
+// Used to display the next sensor
+void TempSensor::nextSensor()
+{
+  if(m_sensorCount > 0)
+    m_displayedSensor = (m_displayedSensor + 1) % m_sensorCount;
+}
+
+// Used to set the calibration offset of a sensor (1/100 degree, added to its readings)
+void TempSensor::setOffset(byte sensor, int offset)
+{
+  if(sensor < TEMP_MAX_SENSORS)
+    m_offsets[sensor] = offset;
+}
+
+// Used to write the resolution (9 to 12 bits) to the configuration register of every sensor.
+// It is not copied to their EEPROM : it is written again at each boot. A running measurement is dropped.
+void TempSensor::setResolution(byte resolution)
+{
+  m_resolution = constrain(resolution, 9, 12);
+  
+  if(m_sensorCount == 0)
+    return;
+  
+  byte command[5] = {0xCC, DS18B20_WRITE_SCRATCHPAD, 0x4B, 0x46, 0x1F}; // Skip ROM, alarm registers (unused) at their power-up values
+  
+  command[4] |= (m_resolution - 9) << 5; // Configuration register
+  
+  m_bus.waitIdle();
+  m_bus.start(command, 5, 0);
+  m_bus.waitIdle();
+  
+  m_state = TEMP_IDLE;
+}
+
+// Used to get the longest conversion time at the current resolution (ms)
+unsigned long TempSensor::getConversionTime()
+{
+  return DS18B20_CONVERSION_TIME >> (12 - m_resolution);
+}
+
+// Used to get the last temp of a sensor, calibrated (1/100 degree)
+int TempSensor::getTemp(byte sensor)
+{
+  return sensor < m_sensorCount ? m_temps[sensor] : 0;
+}
+
+// Used to ask every sensor to start computing the temperature at once (every TEMP_CHECK_INTERVAL).
+// The bus transaction runs in background, update() then follows the measurement.
+void TempSensor::startConversion()
+{
+  static const byte command[2] = {0xCC, DS18B20_START_CONVERSION}; // Skip ROM : broadcast to every sensor
+  
+  if(m_sensorCount == 0 || m_bus.isBusy()) // Previous measurement still on the bus : skip this one
+    return;
+  
+  m_bus.start(command, 2, 0);
+  m_state = TEMP_CONVERTING;
+}
+
+// Used to go on with the measurement, without waiting for the bus. Call it every TEMP_POLL_INTERVAL
+// while isMeasuring(). Returns true when the temps have been read (at least one of them).
+boolean TempSensor::update()
+{
+  while(m_state != TEMP_IDLE && !m_bus.isBusy())
   {
-    byte data[9];
-    
-    m_sensor.reset();
-    m_sensor.skip();
-    m_sensor.write(DS18B20_READ_SCRATCHPAD); // Ask to read scratchpad
-    
-    for(int i = 0 ; i < 9 ; i++) // Read 9 bytes
-      data[i] = m_sensor.read();
-    
-    int lowByte = data[0];
-    int highByte = data[1];
-    
-    int tReading = (highByte << 8) + lowByte; // Make a twelve bit int
-    int signBit = tReading & 0x8000; // Test the most significant bit
-    
-    if(signBit) // Negative
-      tReading = (tReading ^ 0xFFFF) + 1; // 2's comp
+    if(m_state == TEMP_CONVERTING) // Poll : the sensors hold the bus low during read slots until they are all done
+    {
+      m_bus.start(NULL, 0, 1, false);
+      m_state = TEMP_POLLING;
+    }
+    else if(m_state == TEMP_POLLING)
+    {
+      if(m_bus.getData()[0] == 0x00) // Not done, poll again next time
+      {
+        m_state = TEMP_CONVERTING;
+        return false;
+      }
       
-    int tc100 = (6 * tReading) + tReading / 4; // Multiply by (100 * 0.0625) or 6.25
-    
-    m_tempWhole = tc100 / 100; // Get the whole portion
-    m_tempFract = tc100 % 100; // Get the fractionnal portion
-    
-    m_conversionAsked = false; // We do not want to read the scratchpad before asking for a new conversion
-    
-    return true; // Temp changed
+      m_readDone = false;
+      startRead(0);
+    }
+    else // TEMP_READING
+    {
+      if(checkScratchpad(m_readSensor))
+        m_readDone = true;
+      
+      if(m_readSensor + 1 < m_sensorCount)
+        startRead(m_readSensor + 1);
+      else
+      {
+        m_state = TEMP_IDLE;
+        return m_readDone;
+      }
+    }
+  }
+  
+  return false;
+}
+
+// Used to know if a measurement is running
+boolean TempSensor::isMeasuring()
+{
+  return m_state != TEMP_IDLE;
+}
+
+// Used to start reading the scratchpad of a sensor
+void TempSensor::startRead(byte sensor)
+{
+  byte command[10];
+  
+  command[0] = 0x55; // Match ROM
+  for(int i = 0 ; i < 8 ; i++)
+    command[i + 1] = m_addresses[sensor][i];
+  command[9] = DS18B20_READ_SCRATCHPAD;
+  
+  m_bus.start(command, 10, 9);
+  m_readSensor = sensor;
+  m_state = TEMP_READING;
+}
+
+// Used to check the scratchpad read from a sensor and keep its temp. Returns false if it was rejected :
+// no presence pulse, bad CRC or invalid configuration byte (all zeros from a shorted bus for example).
+boolean TempSensor::checkScratchpad(byte sensor)
+{
+  const byte *data = m_bus.getData();
+  
+  if(!m_bus.getPresence() || OneWire::crc8(data, 8) != data[8] || (data[4] & 0x9F) != 0x1F) // The configuration register reads 0xx11111
+  {
+    m_readErrors++;
+    return false;
   }
   
-  return false; // Temp did no changed
+  int tReading = (int16_t)(((unsigned int)data[1] << 8) | data[0]); // 1/16 degree, two's complement
+  
+  tReading &= ~((1 << (12 - m_resolution)) - 1); // Undefined low bits
+  
+  m_temps[sensor] = tReading * 6 + tReading / 4 + m_offsets[sensor]; // Multiply by (100 * 0.0625) or 6.25
+  
+  return true;
 }
 
-// Used to display the temp
+// Used to get the number of failed scratchpad reads since power-up
+unsigned int TempSensor::getReadErrors()
+{
+  return m_readErrors;
+}
+
+// Used to display the temp of the displayed sensor
 void TempSensor::displayTemp()
 {
-  m_disp->setDigit(1, 10, m_tempWhole / 10); // First digit
-  m_disp->setDigit(5, 10, m_tempWhole - (m_tempWhole / 10) * 10); // Second digit
+  int temp = getTemp(m_displayedSensor);
+  int whole = abs(temp) / 100;
+  int fract = abs(temp) % 100;
+  
+  m_disp->setDigit(1, 10, (whole / 10) % 10); // First digit
+  m_disp->setDigit(5, 10, whole % 10); // Second digit
   m_disp->setLed(9, 14, true); // Dot
-  m_disp->setDigit(11, 10, m_tempFract / 10); // fractionnal portion
+  m_disp->setDigit(11, 10, fract / 10); // fractionnal portion
+  
+  // Minus sign
+  m_disp->drawGlyph(1, 1, temp < 0 ? '-' : ' ');
   
   // Degre Symbol
   m_disp->setLed(10, 1, true);
   
   // C
-  m_disp->setLed(12, 1, true); m_disp->setLed(13, 1, true); m_disp->setLed(14, 1, true);
-  m_disp->setLed(12, 2, true);
-  m_disp->setLed(12, 3, true);
-  m_disp->setLed(12, 4, true);
-  m_disp->setLed(12, 5, true); m_disp->setLed(13, 5, true); m_disp->setLed(14, 5, true);
+  m_disp->drawGlyph(12, 1, 'C', BLIT_OR);
+  
+  // Displayed sensor, when there are several
+  for(int i = 0 ; i < TEMP_MAX_SENSORS ; i++)
+    m_disp->setLed(1 + i * 2, 7, m_sensorCount > 1 && i == m_displayedSensor);
+}
+
+// Used to write the temp of a sensor as "21.5`C", '`' being the degree sign of the font (text must hold 8 characters)
+void TempSensor::getTempText(char *text, byte sensor)
+{
+  int temp = getTemp(sensor);
+  int whole = abs(temp) / 100;
+  
+  if(temp < 0)
+    *text++ = '-';
+  
+  if(whole >= 100)
+    *text++ = '0' + whole / 100;
+  
+  if(whole >= 10)
+    *text++ = '0' + (whole / 10) % 10;
+  
+  *text++ = '0' + whole % 10;
+  *text++ = '.';
+  *text++ = '0' + (abs(temp) % 100) / 10;
+  *text++ = FONT_DEGREE;
+  *text++ = 'C';
+  *text = '\0';
 }
 
 // ---------- DEBUGING FUNCTIONS --------
@@ -108,6 +278,9 @@ void TempSensor::displayTemp()
 #ifdef DEBUG
 void TempSensor::printTemp()
 {
-  Serial.println(String(m_tempWhole) + "." + ((m_tempFract < 10) ? "0" : "") + String(m_tempFract));
+  Serial.println("Read errors : " + String(m_readErrors));
+  
+  for(int i = 0 ; i < m_sensorCount ; i++)
+    Serial.println(String(i) + " : " + String(m_temps[i] / 100) + "." + ((abs(m_temps[i]) % 100 < 10) ? "0" : "") + String(abs(m_temps[i]) % 100));
 }
 #endif
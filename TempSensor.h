@@ -14,34 +14,59 @@
 #include <OneWire.h>
 
 #include "Display.h"
+#include "OneWireBus.h"
 
+#define DS18B20_FAMILY 0x28
 #define DS18B20_START_CONVERSION 0x44
 #define DS18B20_READ_SCRATCHPAD 0xBE
+#define DS18B20_WRITE_SCRATCHPAD 0x4E
+#define DS18B20_CONVERSION_TIME 750UL // At 12 bits, halved for each bit less
 
-#define TEMP_CONVERSION_DELAY 1000UL
+#define TEMP_MAX_SENSORS 4
+
+#define TEMP_POLL_INTERVAL 10UL // Between two conversion-done polls
 #define TEMP_CHECK_INTERVAL 5000UL
 
 class TempSensor
 {
   public:
     TempSensor(Display *disp);
-    boolean updateTemp();
+    void initializeSensors();
+    byte getSensorCount();
+    void nextSensor();
+    void setOffset(byte sensor, int offset);
+    void setResolution(byte resolution);
+    unsigned long getConversionTime();
+    int getTemp(byte sensor);
+    void startConversion();
+    boolean update();
+    boolean isMeasuring();
+    unsigned int getReadErrors();
     void displayTemp();
+    void getTempText(char *text, byte sensor);
     
     #ifdef DEBUG
       void printTemp();
     #endif
   
   private:
-    int m_tempWhole;
-    int m_tempFract;
+    byte m_addresses[TEMP_MAX_SENSORS][8]; // ROM codes, in search order
+    byte m_sensorCount;
+    byte m_displayedSensor;
+    byte m_resolution; // 9 to 12 bits
+    unsigned int m_readErrors;
+    int m_temps[TEMP_MAX_SENSORS]; // 1/100 degree
+    int m_offsets[TEMP_MAX_SENSORS]; // 1/100 degree
     
     Display *m_disp;
-    OneWire m_sensor;
-    boolean m_conversionAsked;
-    unsigned long m_conversionStartTime;
+    OneWire m_sensor; // Blocking library, used for the ROM search
+    OneWireBus m_bus; // Background transactions
+    byte m_state;
+    byte m_readSensor; // Scratchpad being read
+    boolean m_readDone; // At least one temp read during this measurement
     
-    void startConversion();
+    void startRead(byte sensor);
+    boolean checkScratchpad(byte sensor);
 };
 
 #endif
@@ -14,13 +14,31 @@
 #include "WProgram.h"
 #endif
 
-#include <Wire.h>
-
 #include "TimeHandler.h"
 #include "Display.h"
 #include "InputHandler.h"
+#include "PinChange.h"
 #include "settings.h"
 
+#ifdef PIN_RTC_SQW
+// Seconds started by the falling edges of the square wave and not counted yet
+static volatile byte rtcPendingTicks = 0;
+static volatile unsigned long rtcEdgeTime = 0UL;
+static volatile boolean rtcEdgeSeen = false;
+
+static void rtcSquareWaveInterrupt()
+{
+  if(digitalRead(PIN_RTC_SQW) == LOW)
+  {
+    if(rtcPendingTicks < 255)
+      rtcPendingTicks++;
+
+    rtcEdgeTime = millis();
+    rtcEdgeSeen = true;
+  }
+}
+#endif
+
 // Constructor
 TimeHandler::TimeHandler(Display *disp, InputHandler *inputs)
 {
@@ -33,58 +51,326 @@ TimeHandler::TimeHandler(Display *disp, InputHandler *inputs)
   m_year = 0U;
 
   m_binaryMode = false;
-  m_lastRTCCheck = 0UL;
   m_timeAdjustment = NO;
 
+  m_tickTime = 0UL;
+  m_tickFraction = 0UL;
+  m_secondLength = 1000000UL;
+  m_lastSync = 0UL;
+  m_refMillis = 0UL;
+  m_refSeconds = 0UL;
+  m_refValid = false;
+  m_squareWave = false;
+  m_squareWaveAttached = false;
+  m_syncPending = false;
+
   m_disp = disp;
   m_inputs = inputs;
 }
 
-// Used to get the time from the chronodot
+// Used to start reading the time from the chronodot in background (see updateTime())
+void TimeHandler::requestRTCTime()
+{
+  byte reg = 0x00; // Start at register 0
+
+  // Seven bytes (seconds, minutes, hours, dow, dom, month, year)
+  if(m_bus.start(CHRONODOT_ADDR, &reg, 1, 7))
+  {
+    m_syncPending = true;
+    m_lastSync = millis();
+  }
+}
+
+// Used to get the time from the last reading of the chronodot
 void TimeHandler::getRTCTime()
 {
-  Wire.beginTransmission(CHRONODOT_ADDR);
-  Wire.write((byte)0x00); // Start at register 0
-  Wire.endTransmission();
-  Wire.requestFrom(CHRONODOT_ADDR, 7); // Request seven bytes (seconds, minutes, hours, dow, dom, month, year)
+  const byte *data = m_bus.getData();
+
+  m_secs = (unsigned int)bcdToDec(data[0]);
+  m_mins = (unsigned int)bcdToDec(data[1]);
+  m_hours = (unsigned int)bcdToDec(data[2]);
+  m_DOW = (unsigned int)bcdToDec(data[3]);
+  m_DOM = (unsigned int)bcdToDec(data[4]);
+  m_month = (unsigned int)bcdToDec(data[5]);
+  m_year = (unsigned int)bcdToDec(data[6]);
+}
+
+// Used to update the time : the seconds elapsed since the last call are counted locally, and the RTC is only
+// read every RTC_SYNC_INTERVAL, in background. Returns the fields that changed (TIME_CHANGED_*), 0 if nothing changed.
+// While adjustTime() runs, the fields belong to it : the seconds still go by (so that getTimeToNextTick() moves on),
+// but they are not counted, and the RTC is not read.
+byte TimeHandler::updateTime()
+{
+  byte changed = 0;
+  boolean adjusting = m_timeAdjustment != NO;
+
+  #ifdef PIN_RTC_SQW
+    if(m_squareWaveAttached)
+      checkSquareWave();
+
+    if(m_squareWave)
+    {
+      noInterrupts();
+      byte ticks = rtcPendingTicks;
+      rtcPendingTicks = 0;
+      interrupts();
+
+      while(ticks-- > 0 && !adjusting)
+        changed |= tick();
+    }
+  #endif
 
-  while(Wire.available()) // Wait for the data to come
+  while(!m_squareWave && getTimeToNextTick() == 0UL)
   {
-    // Read the data
-    m_secs = (unsigned int)bcdToDec(Wire.read());
-    m_mins = (unsigned int)bcdToDec(Wire.read());
-    m_hours = (unsigned int)bcdToDec(Wire.read());
-    m_DOW = (unsigned int)bcdToDec(Wire.read());
-    m_DOM = (unsigned int)bcdToDec(Wire.read());
-    m_month = (unsigned int)bcdToDec(Wire.read());
-    m_year = (unsigned int)bcdToDec(Wire.read());
+    m_tickFraction += m_secondLength;
+    m_tickTime += m_tickFraction / 1000UL;
+    m_tickFraction %= 1000UL;
+
+    if(!adjusting)
+      changed |= tick();
   }
+
+  if(m_syncPending)
+  {
+    byte status = m_bus.update();
+
+    if(status == TWI_DONE && adjusting) // Outdated by the adjustment (setRTCTime() restarts the synchronization)
+      m_syncPending = false;
+    else if(status == TWI_DONE)
+    {
+      m_syncPending = false;
+      changed |= syncRTC();
+    }
+    else if(status != TWI_BUSY) // No answer : keep the local time and try again later
+    {
+      m_syncPending = false;
+      m_lastSync -= RTC_SYNC_INTERVAL - RTC_RETRY_DELAY;
+    }
+  }
+  else if(!adjusting && millis() - m_lastSync >= RTC_SYNC_INTERVAL)
+  {
+    boolean syncWindow = true;
+
+    #ifdef PIN_RTC_SQW
+      // Just after an edge, so that the next one cannot come before the reading
+      if(m_squareWave)
+        syncWindow = millis() - rtcEdgeTime < RTC_SQW_SYNC_WINDOW;
+    #endif
+
+    if(syncWindow)
+      requestRTCTime();
+  }
+
+  return changed;
 }
 
-// Used to update the time.
-boolean TimeHandler::updateTime()
+#ifdef PIN_RTC_SQW
+// Used to follow the square wave : without an edge for RTC_SQW_TIMEOUT (SQW not wired, or not running), the seconds
+// are counted with millis() from the last edge, until the edges come back
+void TimeHandler::checkSquareWave()
 {
-  if((millis() - m_lastRTCCheck) >= RTC_CHECK_INTERVAL || m_lastRTCCheck == 0)
+  noInterrupts();
+  unsigned long edgeTime = rtcEdgeTime;
+  byte ticks = rtcPendingTicks;
+  interrupts();
+
+  if(m_squareWave && millis() - edgeTime >= RTC_SQW_TIMEOUT)
   {
-    getRTCTime();
-    m_lastRTCCheck = millis();
+    m_squareWave = false;
+    m_tickTime = edgeTime;
+    m_tickFraction = 0UL;
+  }
+  else if(!m_squareWave && ticks > 0) // This second was counted locally already
+  {
+    noInterrupts();
+    rtcPendingTicks = 0;
+    interrupts();
 
-    return true;
+    m_squareWave = true;
   }
-  else
-    return false;
+}
+#endif
+
+// Used to know when the next local second starts, or when to look at the running RTC reading (ms from now, 0 if it is due)
+unsigned long TimeHandler::getTimeToNextTick()
+{
+  unsigned long wait;
+
+  #ifdef PIN_RTC_SQW
+    if(m_squareWave)
+    {
+      noInterrupts();
+      unsigned long edge = rtcEdgeTime + 1000UL + RTC_SQW_MARGIN;
+      interrupts();
+
+      if(rtcPendingTicks > 0)
+        wait = 0UL;
+      else if(!rtcEdgeSeen) // Phase of the square wave not known yet
+        wait = RTC_SQW_MARGIN;
+      else // Edge late (millis() runs fast) : look again shortly
+        wait = (long)(edge - millis()) > 0 ? edge - millis() : RTC_SQW_MARGIN;
+    }
+    else
+  #endif
+    {
+      unsigned long next = m_tickTime + (m_tickFraction + m_secondLength) / 1000UL;
+
+      wait = (long)(next - millis()) > 0 ? next - millis() : 0UL;
+    }
+
+  if(m_syncPending && wait > RTC_POLL_INTERVAL)
+    wait = RTC_POLL_INTERVAL;
+
+  return wait;
+}
+
+// Used to apply a reading of the RTC (made at m_lastSync) : correct the local time and estimate how fast millis() runs.
+// Returns the fields that changed.
+byte TimeHandler::syncRTC()
+{
+  unsigned int secs = m_secs, mins = m_mins, hours = m_hours, DOM = m_DOM, month = m_month, year = m_year;
+  byte changed = 0;
+
+  getRTCTime();
+
+  if(m_secs != secs)
+    changed |= TIME_CHANGED_SECS;
+  if(m_mins != mins)
+    changed |= TIME_CHANGED_MINS;
+  if(m_hours != hours)
+    changed |= TIME_CHANGED_HOURS;
+  if(m_DOM != DOM || m_month != month || m_year != year)
+    changed |= TIME_CHANGED_DATE;
+
+  if(changed && !m_squareWave) // The local second drifted away : start it again now
+  {
+    m_tickTime = m_lastSync;
+    m_tickFraction = 0UL;
+  }
+
+  // Drift : milliseconds counted since the first reading for the RTC seconds elapsed meanwhile
+  unsigned long seconds = toSeconds();
+  unsigned long elapsed = m_lastSync - m_refMillis;
+
+  if(!m_refValid || seconds < m_refSeconds || seconds - m_refSeconds > 4000000UL) // First reading, time set or millis() about to wrap
+  {
+    m_refMillis = m_lastSync;
+    m_refSeconds = seconds;
+    m_refValid = true;
+  }
+  else if(seconds - m_refSeconds >= RTC_DRIFT_MIN_TIME)
+  {
+    unsigned long rtcSeconds = seconds - m_refSeconds;
+
+    // elapsed * 1000 / rtcSeconds, without overflow
+    m_secondLength = constrain(elapsed / rtcSeconds * 1000UL + (elapsed % rtcSeconds) * 1000UL / rtcSeconds, 1000000UL - RTC_MAX_DRIFT, 1000000UL + RTC_MAX_DRIFT);
+  }
+
+  return changed;
+}
+
+// Used to add one second to the local time. Returns the fields that changed.
+byte TimeHandler::tick()
+{
+  if(++m_secs < 60U)
+    return TIME_CHANGED_SECS;
+
+  m_secs = 0U;
+
+  if(++m_mins < 60U)
+    return TIME_CHANGED_SECS | TIME_CHANGED_MINS;
+
+  m_mins = 0U;
+
+  if(++m_hours < 24U)
+    return TIME_CHANGED_SECS | TIME_CHANGED_MINS | TIME_CHANGED_HOURS;
+
+  m_hours = 0U;
+  m_DOW = (m_DOW == 7U) ? 1U : m_DOW + 1U;
+
+  if(++m_DOM > daysInMonth(m_month, m_year))
+  {
+    m_DOM = 1U;
+
+    if(++m_month > 12U)
+    {
+      m_month = 1U;
+      m_year = (m_year == 99U) ? 0U : m_year + 1U;
+    }
+  }
+
+  return TIME_CHANGED_SECS | TIME_CHANGED_MINS | TIME_CHANGED_HOURS | TIME_CHANGED_DATE;
+}
+
+// Used to get the length of a month (years 2000 to 2099)
+byte TimeHandler::daysInMonth(unsigned int month, unsigned int year)
+{
+  static const byte days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+  if(month == 2U && year % 4U == 0U)
+    return 29;
+
+  return (month >= 1U && month <= 12U) ? days[month - 1] : 31;
+}
+
+// Used to get the time as seconds since 2000-01-01 00:00:00
+unsigned long TimeHandler::toSeconds()
+{
+  unsigned long days = m_year * 365UL + (m_year + 3U) / 4U; // Leap days of the previous years
+
+  for(unsigned int i = 1U ; i < m_month && i <= 12U ; i++)
+    days += daysInMonth(i, m_year);
+
+  days += m_DOM - 1U;
+
+  return ((days * 24UL + m_hours) * 60UL + m_mins) * 60UL + m_secs;
 }
 
 // Used to initialize the RTC (Chronodot)
 void TimeHandler::initializeRTC()
 {
-  Wire.begin(); // Initialize the Wire library
+  m_bus.begin();
 
   // Clear /EOSC bit
-  Wire.beginTransmission(CHRONODOT_ADDR);
-  Wire.write((byte)0x0E); // Select register
-  Wire.write((byte)B00011100); // Write register bitmap, bit 7 is /EOSC
-  Wire.endTransmission();
+  #ifdef PIN_RTC_SQW
+    byte control[2] = {0x0E, B00000000}; // Register, then bitmap : bit 7 is /EOSC, INTCN cleared and RS2-RS1 = 00 : 1 Hz square wave
+  #else
+    byte control[2] = {0x0E, B00011100}; // Register, then bitmap : bit 7 is /EOSC
+  #endif
+
+  m_bus.start(CHRONODOT_ADDR, control, 2, 0);
+  m_bus.waitIdle();
+
+  #ifdef PIN_RTC_SQW
+    // Open drain output
+    pinMode(PIN_RTC_SQW, INPUT);
+    digitalWrite(PIN_RTC_SQW, HIGH);
+
+    int interrupt = digitalPinToInterrupt(PIN_RTC_SQW);
+
+    if(interrupt != NOT_AN_INTERRUPT)
+    {
+      attachInterrupt(interrupt, rtcSquareWaveInterrupt, FALLING);
+      m_squareWaveAttached = true;
+    }
+    else
+      m_squareWaveAttached = attachPinChange(PIN_RTC_SQW, rtcSquareWaveInterrupt);
+
+    m_squareWave = m_squareWaveAttached;
+    rtcEdgeTime = millis(); // The first edge is expected within RTC_SQW_TIMEOUT (see checkSquareWave())
+  #endif
+
+  // First reading, the local time goes on from here
+  requestRTCTime();
+  m_syncPending = false;
+
+  if(m_bus.waitIdle() == TWI_DONE)
+    syncRTC();
+  else
+    m_lastSync -= RTC_SYNC_INTERVAL - RTC_RETRY_DELAY;
+
+  m_tickTime = m_lastSync;
+  m_tickFraction = 0UL;
 }
 
 // Used to display the current time
@@ -99,13 +385,13 @@ void TimeHandler::displayTime()
     for(int i = 0 ; i < 60 ; i++)
     {
       if(i <= 15) // top
-        m_disp->setLed(i, 0, (boolean) i <= m_secs);
+        m_disp->setLed(i, 0, i <= (int)m_secs);
       else if(i <= 30) // right
-        m_disp->setLed(15, i - 15, (boolean) i <= m_secs);
+        m_disp->setLed(15, i - 15, i <= (int)m_secs);
       else if(i <= 45) // bottom
-        m_disp->setLed(45 - i, 15, (boolean) i <= m_secs);
+        m_disp->setLed(45 - i, 15, i <= (int)m_secs);
       else // left
-      m_disp->setLed(0, 60 - i, (boolean) i <= m_secs);
+      m_disp->setLed(0, 60 - i, i <= (int)m_secs);
     }
 
     m_disp->setLed(15, 0, true);
@@ -149,19 +435,36 @@ byte TimeHandler::bcdToDec(byte val)
 // Used to write time to the RTC
 void TimeHandler::setRTCTime()
 {
-  Wire.beginTransmission(CHRONODOT_ADDR);
-  Wire.write((byte)0x00); // Start at register 0x00 (seconnds)
+  byte data[8];
+
+  data[0] = 0x00; // Start at register 0x00 (seconnds)
 
   // Write the data
-  Wire.write(decToBcd((byte)m_secs));
-  Wire.write(decToBcd((byte)m_mins));
-  Wire.write(decToBcd((byte)m_hours));
-  Wire.write(decToBcd((byte)m_DOW));
-  Wire.write(decToBcd((byte)m_DOM));
-  Wire.write(decToBcd((byte)m_month));
-  Wire.write(decToBcd((byte)m_year));
-
-  Wire.endTransmission();
+  data[1] = decToBcd((byte)m_secs);
+  data[2] = decToBcd((byte)m_mins);
+  data[3] = decToBcd((byte)m_hours);
+  data[4] = decToBcd((byte)m_DOW);
+  data[5] = decToBcd((byte)m_DOM);
+  data[6] = decToBcd((byte)m_month);
+  data[7] = decToBcd((byte)m_year);
+
+  m_bus.waitIdle(); // A reading may be running, it is outdated anyway
+  m_bus.start(CHRONODOT_ADDR, data, 8, 0);
+  m_syncPending = false;
+
+  // Writing the seconds restarts the RTC second : so does the local one, and the drift estimation
+  m_tickTime = millis();
+  m_tickFraction = 0UL;
+  m_lastSync = m_tickTime;
+  m_refValid = false;
+
+  #ifdef PIN_RTC_SQW
+    noInterrupts();
+    rtcPendingTicks = 0;
+    rtcEdgeTime = m_tickTime;
+    rtcEdgeSeen = true;
+    interrupts();
+  #endif
 }
 
 // Used to adjust the time. Returns : 0 : display buffer not modified, 1 : display buffer modified, 2 : adjusting time finished
@@ -180,12 +483,12 @@ int TimeHandler::adjustTime()
   {
     boolean displayModified = false;
     
-    if(m_inputs->getSinglePress(PLUS))
+    if(m_inputs->getRepeatPress(PLUS))
     {
       m_DOM = (m_DOM == 31U) ? 1U : m_DOM + 1U;
       displayModified = true;
     }
-    else if(m_inputs->getSinglePress(MINUS))
+    else if(m_inputs->getRepeatPress(MINUS))
     {
       m_DOM = (m_DOM == 1U) ? 31U : m_DOM - 1U;
       displayModified = true;
@@ -207,12 +510,12 @@ int TimeHandler::adjustTime()
   {
     boolean displayModified = false;
     
-    if(m_inputs->getSinglePress(PLUS))
+    if(m_inputs->getRepeatPress(PLUS))
     {
       m_month = (m_month == 12U) ? 1U : m_month + 1U;
       displayModified = true;
     }
-    else if(m_inputs->getSinglePress(MINUS))
+    else if(m_inputs->getRepeatPress(MINUS))
     {
       m_month = (m_month == 1U) ? 12U : m_month - 1U;
       displayModified = true;
@@ -234,12 +537,12 @@ int TimeHandler::adjustTime()
   {
     boolean displayModified = false;
     
-    if(m_inputs->getSinglePress(PLUS))
+    if(m_inputs->getRepeatPress(PLUS))
     {
       m_DOW = (m_DOW == 7U) ? 1U : m_DOW + 1U;
       displayModified = true;
     }
-    else if(m_inputs->getSinglePress(MINUS))
+    else if(m_inputs->getRepeatPress(MINUS))
     {
       m_DOW = (m_DOW == 1U) ? 7U : m_DOW - 1U;
       displayModified = true;
@@ -261,12 +564,12 @@ int TimeHandler::adjustTime()
   {
     boolean displayModified = false;
     
-    if(m_inputs->getSinglePress(PLUS))
+    if(m_inputs->getRepeatPress(PLUS))
     {
       m_year = (m_year == 99U) ? 0U : m_year + 1U;
       displayModified = true;
     }
-    else if(m_inputs->getSinglePress(MINUS))
+    else if(m_inputs->getRepeatPress(MINUS))
     {
       m_year = (m_year == 0U) ? 99U : m_year - 1U;
       displayModified = true;
@@ -316,12 +619,12 @@ int TimeHandler::adjustTime()
   {
     boolean displayModified = false;
 
-    if(m_inputs->getSinglePress(PLUS))
+    if(m_inputs->getRepeatPress(PLUS))
     {
       m_hours = (m_hours == 23U) ? 0U : m_hours + 1U;
       displayModified = true;
     }
-    else if(m_inputs->getSinglePress(MINUS))
+    else if(m_inputs->getRepeatPress(MINUS))
     {
       m_hours = (m_hours == 0U) ? 23U : m_hours - 1U;
       displayModified = true;
@@ -343,12 +646,12 @@ int TimeHandler::adjustTime()
   {
     boolean displayModified = false;
 
-    if(m_inputs->getSinglePress(PLUS))
+    if(m_inputs->getRepeatPress(PLUS))
     {
       m_mins = (m_mins == 59U) ? 0U : m_mins + 1U;
       displayModified = true;
     }
-    else if(m_inputs->getSinglePress(MINUS))
+    else if(m_inputs->getRepeatPress(MINUS))
     {
       m_mins = (m_mins == 0U) ? 59U : m_mins - 1U;
       displayModified = true;
@@ -447,6 +750,37 @@ void TimeHandler::displayBinaryTime()
   }
 }
 
+// Used to write the time as "hh:mm" (text must hold 6 characters)
+void TimeHandler::getTimeText(char *text)
+{
+  text[0] = '0' + m_hours / 10;
+  text[1] = '0' + m_hours % 10;
+  text[2] = ':';
+  text[3] = '0' + m_mins / 10;
+  text[4] = '0' + m_mins % 10;
+  text[5] = '\0';
+}
+
+// Used to write the date as "dd/mm/yy" or "mm/dd/yy" (text must hold 9 characters)
+void TimeHandler::getDateText(char *text)
+{
+#ifdef MODE_DMY
+  unsigned int first = m_DOM, second = m_month;
+#else
+  unsigned int first = m_month, second = m_DOM;
+#endif
+
+  text[0] = '0' + first / 10;
+  text[1] = '0' + first % 10;
+  text[2] = '/';
+  text[3] = '0' + second / 10;
+  text[4] = '0' + second % 10;
+  text[5] = '/';
+  text[6] = '0' + m_year / 10;
+  text[7] = '0' + m_year % 10;
+  text[8] = '\0';
+}
+
 // --------- Debuging functions ---------
 #ifdef DEBUG
 
@@ -15,9 +15,23 @@
 
 #include "Display.h"
 #include "InputHandler.h"
+#include "TwiBus.h"
 #include "settings.h"
 
-#define RTC_CHECK_INTERVAL 300UL
+#define RTC_SYNC_INTERVAL 900000UL // The local time is resynchronized from the RTC every 15 minutes
+#define RTC_RETRY_DELAY 10000UL // Next try after a failed reading
+#define RTC_POLL_INTERVAL 1UL // Polling period of a running reading (ms)
+#define RTC_DRIFT_MIN_TIME 600UL // Seconds between two RTC readings before estimating the drift of millis()
+#define RTC_MAX_DRIFT 20000UL // Limit of the correction of the local second (us, 2 %)
+#define RTC_SQW_MARGIN 2UL // Delay after the expected square wave edge before updating (ms)
+#define RTC_SQW_SYNC_WINDOW 100UL // The RTC is only read this long after an edge (ms)
+#define RTC_SQW_TIMEOUT 1500UL // Without an edge for this long, the seconds are counted with millis() (ms)
+
+// Fields changed by updateTime()
+#define TIME_CHANGED_SECS B00000001
+#define TIME_CHANGED_MINS B00000010
+#define TIME_CHANGED_HOURS B00000100
+#define TIME_CHANGED_DATE B00001000
 
 #define MODE_DMY // Comment for MDY mode
 
@@ -31,9 +45,12 @@ class TimeHandler
     void displayTime();
     void displayDate();
     void initializeRTC();
-    boolean updateTime();
+    byte updateTime();
+    unsigned long getTimeToNextTick();
     void changeTimeDisplayMode();
     int adjustTime();
+    void getTimeText(char *text);
+    void getDateText(char *text);
     
     #ifdef DEBUG
       void printTime();
@@ -49,16 +66,38 @@ class TimeHandler
     unsigned int m_year;
     
     boolean m_binaryMode;
-    unsigned long m_lastRTCCheck;
     int m_timeAdjustment;
     
+    // Local time base
+    unsigned long m_tickTime; // millis() of the last local second
+    unsigned long m_tickFraction; // Sub-millisecond part of m_tickTime (us)
+    unsigned long m_secondLength; // Length of a second measured with millis() (us)
+    unsigned long m_lastSync;
+    unsigned long m_refMillis; // First RTC reading of the drift estimation
+    unsigned long m_refSeconds;
+    boolean m_refValid;
+    boolean m_squareWave; // The seconds come from the RTC square wave
+    boolean m_squareWaveAttached; // Its interrupt is set up (see checkSquareWave())
+    boolean m_syncPending; // Reading of the RTC running on the bus
+    
+    TwiBus m_bus;
+    
     Display *m_disp;
     InputHandler *m_inputs;
     
     byte decToBcd(byte val);
     byte bcdToDec(byte val);
     void setRTCTime();
+    void requestRTCTime();
     void getRTCTime();
+    byte syncRTC();
+    byte tick();
+    
+    #ifdef PIN_RTC_SQW
+      void checkSquareWave();
+    #endif
+    byte daysInMonth(unsigned int month, unsigned int year);
+    unsigned long toSeconds();
     
     void displayDOM();
     void displayDOW();
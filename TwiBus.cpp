@@ -0,0 +1,220 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * TwiBus.cpp : Implements the TwiBus class, which runs I2C master transactions (bytes written, then bytes
+ * read after a repeated start) in background : the TWI interrupt steps through the transaction and
+ * update() gives up after TWI_TIMEOUT_DELAY, so a stuck device or bus never blocks the caller.
+ * It replaces the Wire library, whose TWI interrupt would conflict with this one.
+ */
+
+#if defined(ARDUINO) && ARDUINO >= 100
+  #include <Arduino.h>
+#else
+  #include "WProgram.h"
+#endif
+
+#if defined(__AVR__)
+  #include <util/twi.h>
+#else
+  #include <Wire.h>
+#endif
+
+#include "TwiBus.h"
+
+#if defined(__AVR__)
+// Bus driven by the TWI interrupt
+static TwiBus *interruptBus = NULL;
+
+ISR(TWI_vect)
+{
+  if(interruptBus != NULL)
+    interruptBus->twiInterrupt();
+}
+#endif
+
+// Constructor
+TwiBus::TwiBus()
+{
+  m_address = 0;
+  m_writeLength = 0;
+  m_readLength = 0;
+  m_index = 0;
+  m_reading = false;
+  m_status = TWI_IDLE;
+  m_startTime = 0UL;
+}
+
+// Used to set up the TWI peripheral, from setup()
+void TwiBus::begin()
+{
+  #if defined(__AVR__)
+    // Internal pull-ups on SDA and SCL
+    digitalWrite(SDA, HIGH);
+    digitalWrite(SCL, HIGH);
+    
+    interruptBus = this;
+    TWSR = 0; // Prescaler 1
+    TWBR = (byte)((F_CPU / TWI_CLOCK - 16UL) / 2UL);
+    TWCR = _BV(TWEN);
+  #else
+    Wire.begin();
+  #endif
+}
+
+// Used to start a transaction (after begin()) : writeLength bytes from data written to the device, then readLength
+// bytes read (see getData()). Returns false if a transaction is still running or the lengths are too long.
+boolean TwiBus::start(byte address, const byte *data, byte writeLength, byte readLength)
+{
+  if(m_status == TWI_BUSY || writeLength > TWI_MAX_WRITE || readLength > TWI_MAX_READ || writeLength + readLength == 0)
+    return false;
+  
+  for(int i = 0 ; i < writeLength ; i++)
+    m_writeData[i] = data[i];
+  
+  for(int i = 0 ; i < readLength ; i++)
+    m_readData[i] = 0;
+  
+  m_address = address;
+  m_writeLength = writeLength;
+  m_readLength = readLength;
+  m_index = 0;
+  m_reading = writeLength == 0;
+  m_startTime = millis();
+  
+  #if defined(__AVR__)
+    m_status = TWI_BUSY;
+    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT) | _BV(TWSTA);
+  #else
+    // No TWI interrupt : the same transaction with the blocking library
+    byte status = TWI_DONE;
+    
+    if(writeLength > 0)
+    {
+      Wire.beginTransmission(address);
+      Wire.write(m_writeData, writeLength);
+      
+      if(Wire.endTransmission() != 0)
+        status = TWI_NACK;
+    }
+    
+    if(status == TWI_DONE && readLength > 0)
+    {
+      if(Wire.requestFrom(address, readLength) != readLength)
+        status = TWI_NACK;
+      
+      for(int i = 0 ; i < readLength && Wire.available() ; i++)
+        m_readData[i] = Wire.read();
+    }
+    
+    m_status = status;
+  #endif
+  
+  return true;
+}
+
+// Used to get the status of the last transaction (TWI_BUSY while it runs), and to abort it after TWI_TIMEOUT_DELAY
+byte TwiBus::update()
+{
+  if(m_status == TWI_BUSY && millis() - m_startTime > TWI_TIMEOUT_DELAY)
+  {
+    #if defined(__AVR__)
+      // Reset the peripheral, which releases SDA and SCL
+      TWCR = 0;
+      TWCR = _BV(TWEN);
+    #endif
+    
+    m_status = TWI_TIMEOUT;
+  }
+  
+  return m_status;
+}
+
+// Used to wait for the end of the running transaction (TWI_TIMEOUT_DELAY at most). Returns its status.
+byte TwiBus::waitIdle()
+{
+  byte status;
+  
+  while((status = update()) == TWI_BUSY)
+    ;
+  
+  return status;
+}
+
+// Used to get the bytes read by the last transaction
+const byte *TwiBus::getData()
+{
+  return m_readData;
+}
+
+// Used to end the transaction with a stop condition
+void TwiBus::stop(byte status)
+{
+  #if defined(__AVR__)
+    TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTO);
+  #endif
+  
+  m_status = status;
+}
+
+// TWI interrupt : one step of the transaction, after each start condition, address or data byte
+void TwiBus::twiInterrupt()
+{
+  #if defined(__AVR__)
+    switch(TW_STATUS)
+    {
+      case TW_START:
+      case TW_REP_START:
+        TWDR = (m_address << 1) | (m_reading ? TW_READ : TW_WRITE);
+        TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT);
+        break;
+      
+      case TW_MT_SLA_ACK:
+      case TW_MT_DATA_ACK:
+        if(m_index < m_writeLength)
+        {
+          TWDR = m_writeData[m_index++];
+          TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT);
+        }
+        else if(m_readLength > 0) // Repeated start to read
+        {
+          m_reading = true;
+          m_index = 0;
+          TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT) | _BV(TWSTA);
+        }
+        else
+          stop(TWI_DONE);
+        break;
+      
+      case TW_MR_DATA_ACK:
+        m_readData[m_index++] = TWDR;
+        // Fall through
+      case TW_MR_SLA_ACK: // Acknowledge every byte but the last one
+        TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWINT) | (m_index + 1 < m_readLength ? _BV(TWEA) : 0);
+        break;
+      
+      case TW_MR_DATA_NACK:
+        m_readData[m_index++] = TWDR;
+        stop(TWI_DONE);
+        break;
+      
+      case TW_MT_SLA_NACK:
+      case TW_MT_DATA_NACK:
+      case TW_MR_SLA_NACK:
+        stop(TWI_NACK);
+        break;
+      
+      case TW_MT_ARB_LOST: // Not the master anymore : no stop condition
+        TWCR = _BV(TWEN) | _BV(TWINT);
+        m_status = TWI_BUS_ERROR;
+        break;
+      
+      default: // Illegal start or stop condition
+        stop(TWI_BUS_ERROR);
+        break;
+    }
+  #endif
+}
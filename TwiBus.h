@@ -0,0 +1,49 @@
+/*
+ * 16 * 16 LED matrix
+ * Created : october 2026
+ * op414
+ * http://op414.net
+ * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * ---------
+ * TwiBus.h : TwiBus class definition.
+ */
+
+#ifndef DEF_TWIBUS
+#define DEF_TWIBUS
+
+#define TWI_MAX_WRITE 8 // Register pointer and the seven time registers of the DS3231
+#define TWI_MAX_READ 7
+#define TWI_CLOCK 100000UL // Hz
+#define TWI_TIMEOUT_DELAY 5UL // ms, a full transaction takes less than 1 ms at 100 kHz
+
+// Lambda enumeration for the status of the last transaction
+enum{TWI_IDLE, TWI_BUSY, TWI_DONE, TWI_NACK, TWI_BUS_ERROR, TWI_TIMEOUT};
+
+class TwiBus
+{
+  public:
+    TwiBus();
+    void begin();
+    boolean start(byte address, const byte *data, byte writeLength, byte readLength);
+    byte update();
+    byte waitIdle();
+    const byte *getData();
+  
+  private:
+    byte m_address;
+    byte m_writeData[TWI_MAX_WRITE];
+    byte m_readData[TWI_MAX_READ];
+    byte m_writeLength;
+    byte m_readLength;
+    volatile byte m_index; // Byte being written or read
+    volatile boolean m_reading;
+    volatile byte m_status;
+    unsigned long m_startTime;
+    
+    void stop(byte status);
+  
+  public:
+    void twiInterrupt(); // Called by the TWI interrupt
+};
+
+#endif
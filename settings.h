@@ -5,12 +5,15 @@
  * http://op414.net
  * License : CC BY-NC-SA http://creativecommons.org/licenses/by-nc-sa/3.0/
  * ---------
- * settings.h : Pins definition and activation/desactivation of DEBUG mode
+ * settings.h : Pins definition, display geometry and activation/desactivation of DEBUG mode and boot animation
  */
 
 //#define DEBUG
 //#define SERIAL_DEBUG
 
+// Boot animation, not played after a watchdog or brown-out reset (comment to never play it)
+#define BOOT_ANIMATION
+
 #define PIN_LOAD 10
 
 #define PIN_RAND A3
@@ -22,3 +25,30 @@
 #define PIN_MINUS 4
 
 #define PIN_TEMP 5
+
+// 1 Hz square wave of the DS3231 (open drain SQW/INT output), the seconds then follow its edges
+// (comment if not wired, the time is then kept with millis())
+#define PIN_RTC_SQW 6
+
+// Resolution of the DS18B20 (9 to 12 bits : 0.5 to 0.0625 degree, 94 to 750 ms per conversion)
+#define TEMP_RESOLUTION 12
+
+// Calibration of the DS18B20 in 1/100 degree, in the order of their ROM codes (TEMP_MAX_SENSORS values)
+#define TEMP_SENSOR_OFFSETS {0, 0, 0, 0}
+
+// Display geometry : panel size in LEDs (multiples of 8, one MAX7219 per 8 * 8 block)
+// and order of the blocks along the MAX7219 chain (see Display.h)
+#define DISPLAY_WIDTH 16
+#define DISPLAY_HEIGHT 16
+#define DISPLAY_CHAIN DISPLAY_CHAIN_ROWS
+
+// SPI clock of the MAX7219 chain in Hz (the closest F_CPU / 2^n below it is used, 10 MHz at most)
+#define DISPLAY_SPI_CLOCK 125000UL
+
+// Frames streamed by a host over the serial port (see SerialStream.h), shown as long as they keep coming
+// (comment to disable). 500000 baud is exact with a 16 MHz crystal and a standard rate on Linux.
+#define SERIAL_STREAM
+#define SERIAL_STREAM_BAUD 500000UL
+
+// Scrolling speed of the marquee mode (ms per column)
+#define MARQUEE_STEP_PERIOD 60UL
@@ -0,0 +1,237 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * Arduino.cpp : Implements the Arduino core stand-in on top of the virtual hardware.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+#include "Simulator.h"
+#include "Wire.h"
+
+// Cost of the core functions on a 16 MHz ATmega328
+#define SIM_DIGITAL_IO_NS 3500ULL
+#define SIM_ANALOG_READ_US 112ULL
+
+#define SIM_SERIAL_RX_BUFFER 64 // Receive buffer of the Arduino core
+
+HardwareSerial Serial;
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  simulator().setPinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  simulator().advanceNanos(SIM_DIGITAL_IO_NS);
+  simulator().writePin(pin, val);
+}
+
+int digitalRead(uint8_t pin)
+{
+  simulator().advanceNanos(SIM_DIGITAL_IO_NS);
+  return simulator().readPin(pin);
+}
+
+int analogRead(uint8_t pin)
+{
+  simulator().advanceMicros(SIM_ANALOG_READ_US);
+  return simulator().readAnalog(pin);
+}
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode)
+{
+  if(interrupt <= 1)
+    simulator().setPinInterrupt(interrupt + 2, handler, mode);
+}
+
+void detachInterrupt(uint8_t interrupt)
+{
+  if(interrupt <= 1)
+    simulator().setPinInterrupt(interrupt + 2, NULL, 0);
+}
+
+unsigned long millis()
+{
+  return (unsigned long)(simulator().now() / 1000ULL);
+}
+
+unsigned long micros()
+{
+  return (unsigned long)simulator().now();
+}
+
+// One millisecond at a time, so that the square wave of the RTC interrupts the wait on time
+void delay(unsigned long ms)
+{
+  for(unsigned long i = 0 ; i < ms ; i++)
+  {
+    simulator().advanceMicros(1000ULL);
+    simUpdateRTC();
+  }
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  simulator().advanceMicros(us);
+}
+
+// Same generator on every host so that runs are reproducible
+static unsigned long simRandomState = 1UL;
+
+void randomSeed(unsigned long seed)
+{
+  if(seed != 0)
+    simRandomState = seed;
+}
+
+long random(long howbig)
+{
+  if(howbig == 0)
+    return 0;
+
+  simRandomState = simRandomState * 1103515245UL + 12345UL;
+  return (long)((simRandomState >> 16) & 0x7FFF) % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+  if(howsmall >= howbig)
+    return howsmall;
+
+  return random(howbig - howsmall) + howsmall;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// ---------- String ----------
+
+std::string String::toString(long val, unsigned char base)
+{
+  char buffer[72];
+  unsigned long u = val;
+  int i = sizeof(buffer) - 1;
+  boolean negative = base == DEC && val < 0;
+
+  if(negative)
+    u = -val;
+
+  buffer[i] = '\0';
+  do
+  {
+    buffer[--i] = "0123456789ABCDEF"[u % base];
+    u /= base;
+  } while(u != 0 && i > 1);
+
+  if(negative)
+    buffer[--i] = '-';
+
+  return std::string(buffer + i);
+}
+
+// ---------- Serial ----------
+
+static int simSerialFd = -1;
+static unsigned long simSerialBaud = 0UL;
+static uint64_t simSerialNextByte = 0ULL; // Virtual time (ns) at which the next byte is received
+static uint8_t simSerialInput[256]; // Read from fd, not received yet
+static int simSerialInputPos = 0, simSerialInputLength = 0;
+static uint8_t simSerialRx[SIM_SERIAL_RX_BUFFER];
+static int simSerialRxTail = 0, simSerialRxCount = 0;
+
+void simSetSerialInput(int fd)
+{
+  simSerialFd = fd;
+}
+
+// Moves the bytes that went down the line since the last call to the receive buffer, like the receive
+// interrupt : the ones arriving while it is full are lost
+static void simReceiveSerial()
+{
+  if(simSerialFd < 0 || simSerialBaud == 0UL)
+    return;
+
+  Simulator &sim = simulator();
+  uint64_t byteTime = 10ULL * 1000000000ULL / simSerialBaud; // Start bit, 8 data bits, stop bit
+
+  while(simSerialNextByte <= sim.nowNanos())
+  {
+    if(simSerialInputPos == simSerialInputLength)
+    {
+      ssize_t length = read(simSerialFd, simSerialInput, sizeof(simSerialInput));
+
+      if(length <= 0) // Idle line : the next byte cannot be received before a byte time
+      {
+        simSerialNextByte = sim.nowNanos() + byteTime;
+        return;
+      }
+
+      simSerialInputPos = 0;
+      simSerialInputLength = (int)length;
+    }
+
+    sim.counters.serialBytes++;
+
+    if(simSerialRxCount == SIM_SERIAL_RX_BUFFER)
+      sim.counters.serialOverruns++;
+    else
+      simSerialRx[(simSerialRxTail + simSerialRxCount++) % SIM_SERIAL_RX_BUFFER] = simSerialInput[simSerialInputPos];
+
+    simSerialInputPos++;
+    simSerialNextByte += byteTime;
+  }
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+  simSerialBaud = baud;
+  simSerialNextByte = simulator().nowNanos() + (baud > 0UL ? 10ULL * 1000000000ULL / baud : 0ULL);
+}
+
+int HardwareSerial::available()
+{
+  simReceiveSerial();
+
+  return simSerialRxCount;
+}
+
+int HardwareSerial::read()
+{
+  simReceiveSerial();
+
+  if(simSerialRxCount == 0)
+    return -1;
+
+  uint8_t val = simSerialRx[simSerialRxTail];
+
+  simSerialRxTail = (simSerialRxTail + 1) % SIM_SERIAL_RX_BUFFER;
+  simSerialRxCount--;
+
+  return val;
+}
+
+size_t HardwareSerial::write(uint8_t val)
+{
+  return fwrite(&val, 1, 1, stdout);
+}
+
+size_t HardwareSerial::print(const char *str)
+{
+  return fputs(str, stdout) >= 0 ? strlen(str) : 0;
+}
+
+size_t HardwareSerial::print(char c)
+{
+  return write((uint8_t)c);
+}
+
+size_t HardwareSerial::print(long val, int base)
+{
+  return print(String(val, base));
+}
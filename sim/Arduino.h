@@ -0,0 +1,159 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * Arduino.h : Stand-in for the Arduino core (types, pins, virtual clock, Serial).
+ */
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <string>
+
+#include "binary.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef unsigned int word;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#ifndef F_CPU
+  #define F_CPU 16000000UL
+#endif
+
+// Flash is ordinary memory on the host
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) ((uint16_t)*(addr))
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+template<class T, class U> inline T min(T a, U b) { return (b < a) ? (T)b : a; }
+template<class T, class U> inline T max(T a, U b) { return (a < b) ? (T)b : a; }
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+// External interrupts INT0 (pin 2) and INT1 (pin 3), run when the simulated input changes
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+
+// Pin change interrupts of the ATmega328 : PCINTn_vect runs when an enabled simulated input changes
+extern uint8_t simPCICR, simPCMSK0, simPCMSK1, simPCMSK2;
+
+#define PCICR simPCICR
+#define PCMSK0 simPCMSK0
+#define PCMSK1 simPCMSK1
+#define PCMSK2 simPCMSK2
+
+#define digitalPinToPCICR(p) (((p) <= 21) ? (&PCICR) : ((uint8_t *)0))
+#define digitalPinToPCICRbit(p) (((p) <= 7) ? 2 : (((p) <= 13) ? 0 : 1))
+#define digitalPinToPCMSK(p) (((p) <= 7) ? (&PCMSK2) : (((p) <= 13) ? (&PCMSK0) : (((p) <= 21) ? (&PCMSK1) : ((uint8_t *)0))))
+#define digitalPinToPCMSKbit(p) (((p) <= 7) ? (p) : (((p) <= 13) ? ((p) - 8) : ((p) - 14)))
+
+#define _BV(bit) (1 << (bit))
+#define ISR(vector) extern "C" void vector()
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void randomSeed(unsigned long seed);
+long random(long howbig);
+long random(long howsmall, long howbig);
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+// Minimal String, only used by the DEBUG prints
+class String
+{
+  public:
+    String(const char *str = "") : m_str(str) {}
+    String(const std::string &str) : m_str(str) {}
+    String(int val, unsigned char base = DEC) : m_str(toString(val, base)) {}
+    String(unsigned int val, unsigned char base = DEC) : m_str(toString(val, base)) {}
+    String(long val, unsigned char base = DEC) : m_str(toString(val, base)) {}
+    String(unsigned long val, unsigned char base = DEC) : m_str(toString(val, base)) {}
+
+    const char *c_str() const { return m_str.c_str(); }
+    unsigned int length() const { return m_str.length(); }
+
+    friend String operator+(const String &a, const String &b) { return String(a.m_str + b.m_str); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.m_str); }
+    friend String operator+(const String &a, const char *b) { return String(a.m_str + b); }
+
+  private:
+    std::string m_str;
+
+    static std::string toString(long val, unsigned char base);
+};
+
+// Serial port, printed to stdout
+class HardwareSerial
+{
+  public:
+    void begin(unsigned long baud);
+    void end() {}
+    int available();
+    int read();
+    size_t write(uint8_t val);
+
+    size_t print(const char *str);
+    size_t print(const String &str) { return print(str.c_str()); }
+    size_t print(char c);
+    size_t print(long val, int base = DEC);
+    size_t print(int val, int base = DEC) { return print((long)val, base); }
+    size_t print(unsigned int val, int base = DEC) { return print((long)val, base); }
+    size_t print(unsigned long val, int base = DEC) { return print((long)val, base); }
+    size_t print(unsigned char val, int base = DEC) { return print((long)val, base); }
+
+    size_t println() { return print("\n"); }
+    template<class T> size_t println(T val) { return print(val) + println(); }
+    template<class T> size_t println(T val, int base) { return print(val, base) + println(); }
+};
+
+extern HardwareSerial Serial;
+
+// Receive line of Serial : the bytes read from fd arrive at the rate set by Serial.begin()
+void simSetSerialInput(int fd);
+
+#endif
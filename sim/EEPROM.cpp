@@ -0,0 +1,93 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * EEPROM.cpp : Implements the EEPROM library stand-in.
+ */
+
+#include <stdio.h>
+
+#include "EEPROM.h"
+#include "Simulator.h"
+
+// Cost of an EEPROM access on the ATmega328
+#define SIM_EEPROM_READ_US 1ULL
+#define SIM_EEPROM_WRITE_US 3300ULL
+
+EEPROMClass EEPROM;
+
+static uint8_t simEeprom[SIM_EEPROM_SIZE];
+static unsigned long simEepromWrites[SIM_EEPROM_SIZE];
+static bool simEepromErased = false;
+
+// A fresh chip reads 0xFF everywhere
+static void simEraseEeprom()
+{
+  if(!simEepromErased)
+  {
+    memset(simEeprom, 0xFF, sizeof(simEeprom));
+    simEepromErased = true;
+  }
+}
+
+uint8_t EEPROMClass::read(int address)
+{
+  simEraseEeprom();
+  simulator().counters.eepromReads++;
+  simulator().advanceMicros(SIM_EEPROM_READ_US);
+
+  return (address >= 0 && address < SIM_EEPROM_SIZE) ? simEeprom[address] : 0xFF;
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+  simEraseEeprom();
+  simulator().counters.eepromWrites++;
+  simulator().advanceMicros(SIM_EEPROM_WRITE_US);
+
+  if(address >= 0 && address < SIM_EEPROM_SIZE)
+  {
+    simEeprom[address] = value;
+    simEepromWrites[address]++;
+  }
+}
+
+void EEPROMClass::update(int address, uint8_t value)
+{
+  if(read(address) != value)
+    write(address, value);
+}
+
+unsigned long simEepromWear(int address)
+{
+  return (address >= 0 && address < SIM_EEPROM_SIZE) ? simEepromWrites[address] : 0UL;
+}
+
+bool simLoadEeprom(const char *path)
+{
+  FILE *file = fopen(path, "rb");
+
+  simEraseEeprom();
+
+  if(file == NULL)
+    return false;
+
+  size_t length = fread(simEeprom, 1, sizeof(simEeprom), file);
+  fclose(file);
+
+  return length == sizeof(simEeprom);
+}
+
+bool simSaveEeprom(const char *path)
+{
+  FILE *file = fopen(path, "wb");
+
+  simEraseEeprom();
+
+  if(file == NULL)
+    return false;
+
+  size_t length = fwrite(simEeprom, 1, sizeof(simEeprom), file);
+  fclose(file);
+
+  return length == sizeof(simEeprom);
+}
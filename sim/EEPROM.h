@@ -0,0 +1,30 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * EEPROM.h : Stand-in for the EEPROM library (1 KB, erased to 0xFF, write counting).
+ */
+
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include "Arduino.h"
+
+#define SIM_EEPROM_SIZE 1024
+
+class EEPROMClass
+{
+  public:
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    void update(int address, uint8_t value);
+    uint16_t length() { return SIM_EEPROM_SIZE; }
+};
+
+extern EEPROMClass EEPROM;
+
+// Per-cell write count (wear) of the simulated EEPROM
+unsigned long simEepromWear(int address);
+bool simLoadEeprom(const char *path);
+bool simSaveEeprom(const char *path);
+
+#endif
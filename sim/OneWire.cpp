@@ -0,0 +1,324 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * OneWire.cpp : Implements the OneWire library stand-in and DS18B20 sensors running on the virtual clock.
+ */
+
+#include "OneWire.h"
+#include "Simulator.h"
+
+// Slot timings of the 1-Wire bus
+#define SIM_ONEWIRE_RESET_US 960ULL
+#define SIM_ONEWIRE_SLOT_US 70ULL
+
+// DS18B20 conversion time at 9 bits of resolution (doubles with each extra bit)
+#define SIM_DS18B20_CONVERSION_9BIT_US 93750ULL
+
+struct SimDS18B20
+{
+  uint8_t rom[8];
+  float temperature;
+  int16_t reading; // Temperature register (1/16 degree), 85 C at power-up
+  uint8_t th, tl, config;
+  uint64_t conversionEnd;
+  bool selected;
+};
+
+// Bus transaction state
+enum {SIM_OW_IDLE, SIM_OW_ROM_COMMAND, SIM_OW_MATCH_ROM, SIM_OW_FUNCTION, SIM_OW_CONVERT, SIM_OW_READ_SCRATCHPAD, SIM_OW_WRITE_SCRATCHPAD};
+
+static SimDS18B20 simSensors[SIM_ONEWIRE_MAX_DEVICES];
+static int simSensorCount = -1; // Not initialized yet
+static int simBusState = SIM_OW_IDLE;
+static int simBusIndex = 0;
+static uint8_t simMatchRom[8];
+
+static void simInitSensors()
+{
+  if(simSensorCount < 0)
+    simSetSensors(1, 21.5f);
+}
+
+void simSetSensors(int count, float temperature)
+{
+  if(count > SIM_ONEWIRE_MAX_DEVICES)
+    count = SIM_ONEWIRE_MAX_DEVICES;
+
+  simSensorCount = count;
+
+  for(int i = 0 ; i < count ; i++)
+  {
+    SimDS18B20 &sensor = simSensors[i];
+    const uint8_t rom[7] = {0x28, (uint8_t)(0x10 + i * 0x21), 0xA5, 0x3C, (uint8_t)i, 0x00, 0x00};
+
+    memcpy(sensor.rom, rom, 7);
+    sensor.rom[7] = OneWire::crc8(rom, 7);
+    sensor.temperature = temperature;
+    sensor.reading = 0x0550;
+    sensor.th = 0x4B;
+    sensor.tl = 0x46;
+    sensor.config = 0x7F; // 12 bits
+    sensor.conversionEnd = 0ULL;
+    sensor.selected = false;
+  }
+}
+
+void simSetSensorTemperature(int sensor, float temperature)
+{
+  simInitSensors();
+
+  if(sensor >= 0 && sensor < simSensorCount)
+    simSensors[sensor].temperature = temperature;
+}
+
+static int simResolution(const SimDS18B20 &sensor)
+{
+  return 9 + ((sensor.config >> 5) & 0x03);
+}
+
+static void simScratchpad(const SimDS18B20 &sensor, uint8_t data[9])
+{
+  data[0] = sensor.reading & 0xFF;
+  data[1] = (sensor.reading >> 8) & 0xFF;
+  data[2] = sensor.th;
+  data[3] = sensor.tl;
+  data[4] = sensor.config;
+  data[5] = 0xFF;
+  data[6] = 0x0C;
+  data[7] = 0x10;
+  data[8] = OneWire::crc8(data, 8);
+}
+
+// Finish the conversions that are due
+static void simUpdateConversions()
+{
+  for(int i = 0 ; i < simSensorCount ; i++)
+  {
+    SimDS18B20 &sensor = simSensors[i];
+
+    if(sensor.conversionEnd != 0ULL && simulator().now() >= sensor.conversionEnd)
+    {
+      int16_t reading = (int16_t)lround(sensor.temperature * 16.0f);
+
+      sensor.reading = reading & ~((1 << (12 - simResolution(sensor))) - 1); // Undefined low bits read as 0
+      sensor.conversionEnd = 0ULL;
+    }
+  }
+}
+
+// ---------- OneWire ----------
+
+uint8_t OneWire::reset()
+{
+  simInitSensors();
+  simulator().counters.oneWireResets++;
+  simulator().advanceMicros(SIM_ONEWIRE_RESET_US);
+  simUpdateConversions();
+
+  simBusState = SIM_OW_ROM_COMMAND;
+  for(int i = 0 ; i < simSensorCount ; i++)
+    simSensors[i].selected = false;
+
+  return simSensorCount > 0 ? 1 : 0;
+}
+
+void OneWire::select(const uint8_t rom[8])
+{
+  write(0x55);
+
+  for(int i = 0 ; i < 8 ; i++)
+    write(rom[i]);
+}
+
+void OneWire::skip()
+{
+  write(0xCC);
+}
+
+void OneWire::write(uint8_t v, uint8_t power)
+{
+  (void)power;
+
+  simulator().counters.oneWireBytes++;
+  simulator().advanceMicros(SIM_ONEWIRE_SLOT_US * 8);
+  simUpdateConversions();
+
+  switch(simBusState)
+  {
+    case SIM_OW_ROM_COMMAND:
+      if(v == 0xCC) // Skip ROM
+      {
+        for(int i = 0 ; i < simSensorCount ; i++)
+          simSensors[i].selected = true;
+        simBusState = SIM_OW_FUNCTION;
+      }
+      else if(v == 0x55) // Match ROM
+      {
+        simBusState = SIM_OW_MATCH_ROM;
+        simBusIndex = 0;
+      }
+      else
+        simBusState = SIM_OW_IDLE;
+      break;
+
+    case SIM_OW_MATCH_ROM:
+      simMatchRom[simBusIndex++] = v;
+      if(simBusIndex == 8)
+      {
+        for(int i = 0 ; i < simSensorCount ; i++)
+          simSensors[i].selected = memcmp(simSensors[i].rom, simMatchRom, 8) == 0;
+        simBusState = SIM_OW_FUNCTION;
+      }
+      break;
+
+    case SIM_OW_FUNCTION:
+      simBusIndex = 0;
+      if(v == 0x44) // Convert T
+      {
+        for(int i = 0 ; i < simSensorCount ; i++)
+        {
+          if(simSensors[i].selected)
+            simSensors[i].conversionEnd = simulator().now() + (SIM_DS18B20_CONVERSION_9BIT_US << (simResolution(simSensors[i]) - 9));
+        }
+        simBusState = SIM_OW_CONVERT;
+      }
+      else if(v == 0xBE) // Read scratchpad
+        simBusState = SIM_OW_READ_SCRATCHPAD;
+      else if(v == 0x4E) // Write scratchpad
+        simBusState = SIM_OW_WRITE_SCRATCHPAD;
+      else
+        simBusState = SIM_OW_IDLE;
+      break;
+
+    case SIM_OW_WRITE_SCRATCHPAD:
+      for(int i = 0 ; i < simSensorCount ; i++)
+      {
+        if(!simSensors[i].selected)
+          continue;
+
+        if(simBusIndex == 0)
+          simSensors[i].th = v;
+        else if(simBusIndex == 1)
+          simSensors[i].tl = v;
+        else if(simBusIndex == 2)
+          simSensors[i].config = (v & 0x60) | 0x1F;
+      }
+      simBusIndex++;
+      break;
+
+    default:
+      break;
+  }
+}
+
+void OneWire::write_bytes(const uint8_t *buf, uint16_t count, bool power)
+{
+  for(uint16_t i = 0 ; i < count ; i++)
+    write(buf[i], power);
+}
+
+// Several selected sensors answering at once give a wired AND
+uint8_t OneWire::read()
+{
+  uint8_t val = 0xFF;
+
+  simulator().counters.oneWireBytes++;
+  simulator().advanceMicros(SIM_ONEWIRE_SLOT_US * 8);
+  simUpdateConversions();
+
+  if(simBusState == SIM_OW_READ_SCRATCHPAD)
+  {
+    for(int i = 0 ; i < simSensorCount ; i++)
+    {
+      uint8_t data[9];
+
+      if(!simSensors[i].selected)
+        continue;
+
+      simScratchpad(simSensors[i], data);
+      val &= simBusIndex < 9 ? data[simBusIndex] : 0xFF;
+    }
+    simBusIndex++;
+  }
+  else if(simBusState == SIM_OW_CONVERT)
+  {
+    val = 0x00;
+
+    for(int i = 0 ; i < 8 ; i++)
+      val |= read_bit() << i;
+  }
+
+  return val;
+}
+
+void OneWire::read_bytes(uint8_t *buf, uint16_t count)
+{
+  for(uint16_t i = 0 ; i < count ; i++)
+    buf[i] = read();
+}
+
+void OneWire::write_bit(uint8_t v)
+{
+  (void)v;
+
+  simulator().advanceMicros(SIM_ONEWIRE_SLOT_US);
+}
+
+// During a conversion, read slots return 0 until every selected sensor is done
+uint8_t OneWire::read_bit()
+{
+  simulator().advanceMicros(SIM_ONEWIRE_SLOT_US);
+  simUpdateConversions();
+
+  if(simBusState == SIM_OW_CONVERT)
+  {
+    for(int i = 0 ; i < simSensorCount ; i++)
+    {
+      if(simSensors[i].selected && simSensors[i].conversionEnd != 0ULL)
+        return 0;
+    }
+  }
+
+  return 1;
+}
+
+// Enumerate the sensors (the bit-level search algorithm is not simulated, only its cost)
+uint8_t OneWire::search(uint8_t *newAddr, bool search_mode)
+{
+  (void)search_mode;
+
+  simInitSensors();
+  reset();
+  write(0xF0);
+  simulator().advanceMicros(SIM_ONEWIRE_SLOT_US * 64 * 3);
+  simBusState = SIM_OW_IDLE;
+
+  if(m_searchIndex >= simSensorCount)
+    return 0;
+
+  memcpy(newAddr, simSensors[m_searchIndex++].rom, 8);
+  return 1;
+}
+
+// Dallas CRC-8 (polynomial x^8 + x^5 + x^4 + 1)
+uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len)
+{
+  uint8_t crc = 0;
+
+  while(len--)
+  {
+    uint8_t inbyte = *addr++;
+
+    for(uint8_t i = 8 ; i ; i--)
+    {
+      uint8_t mix = (crc ^ inbyte) & 0x01;
+
+      crc >>= 1;
+      if(mix)
+        crc ^= 0x8C;
+      inbyte >>= 1;
+    }
+  }
+
+  return crc;
+}
@@ -0,0 +1,44 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * OneWire.h : Stand-in for the OneWire library, wired to simulated DS18B20 sensors.
+ */
+
+#ifndef SIM_ONEWIRE_H
+#define SIM_ONEWIRE_H
+
+#include "Arduino.h"
+
+#define SIM_ONEWIRE_MAX_DEVICES 8
+
+class OneWire
+{
+  public:
+    OneWire(uint8_t pin) : m_pin(pin), m_searchIndex(0) {}
+
+    uint8_t reset();
+    void select(const uint8_t rom[8]);
+    void skip();
+    void write(uint8_t v, uint8_t power = 0);
+    void write_bytes(const uint8_t *buf, uint16_t count, bool power = 0);
+    uint8_t read();
+    void read_bytes(uint8_t *buf, uint16_t count);
+    void write_bit(uint8_t v);
+    uint8_t read_bit();
+    void depower() {}
+
+    void reset_search() { m_searchIndex = 0; }
+    uint8_t search(uint8_t *newAddr, bool search_mode = true);
+
+    static uint8_t crc8(const uint8_t *addr, uint8_t len);
+
+  private:
+    uint8_t m_pin;
+    uint8_t m_searchIndex;
+};
+
+// Simulated DS18B20 sensors on the bus (temperature in degrees Celsius)
+void simSetSensors(int count, float temperature);
+void simSetSensorTemperature(int sensor, float temperature);
+
+#endif
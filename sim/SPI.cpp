@@ -0,0 +1,25 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * SPI.cpp : Implements the SPI library stand-in.
+ */
+
+#include "SPI.h"
+#include "Simulator.h"
+
+SPIClass SPI;
+
+// Translate the SPCR/SPSR clock setting into the actual divider
+void SPIClass::setClockDivider(uint8_t rate)
+{
+  static const uint8_t dividers[8] = {4, 16, 64, 128, 2, 8, 32, 64};
+
+  simulator().setSpiClockDivider(dividers[rate & 0x07]);
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+  simulator().spiTransfer(data);
+
+  return 0x00; // MISO is not connected
+}
@@ -0,0 +1,38 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * SPI.h : Stand-in for the SPI library, wired to a simulated MAX7219 chain.
+ */
+
+#ifndef SIM_SPI_H
+#define SIM_SPI_H
+
+#include "Arduino.h"
+
+#define SPI_CLOCK_DIV4 0x00
+#define SPI_CLOCK_DIV16 0x01
+#define SPI_CLOCK_DIV64 0x02
+#define SPI_CLOCK_DIV128 0x03
+#define SPI_CLOCK_DIV2 0x04
+#define SPI_CLOCK_DIV8 0x05
+#define SPI_CLOCK_DIV32 0x06
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPIClass
+{
+  public:
+    static void begin() {}
+    static void end() {}
+    static void setBitOrder(uint8_t bitOrder) { (void)bitOrder; }
+    static void setDataMode(uint8_t mode) { (void)mode; }
+    static void setClockDivider(uint8_t rate);
+    static uint8_t transfer(uint8_t data);
+};
+
+extern SPIClass SPI;
+
+#endif
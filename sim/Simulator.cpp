@@ -0,0 +1,182 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * Simulator.cpp : Implements the virtual hardware (clock, pins, MAX7219 chain).
+ */
+
+#include <string.h>
+
+#include "Simulator.h"
+#include "settings.h"
+
+// MAX7219 registers
+#define SIM_MAX_REG_NOOP 0x00
+#define SIM_MAX_REG_DIGIT7 0x08
+#define SIM_MAX_REG_INTENSITY 0x0A
+#define SIM_MAX_REG_SHUTDOWN 0x0C
+
+uint8_t simPCICR = 0, simPCMSK0 = 0, simPCMSK1 = 0, simPCMSK2 = 0;
+
+// Pin change vectors, defined by the firmware if it uses them
+extern "C" void PCINT0_vect() __attribute__((weak));
+extern "C" void PCINT1_vect() __attribute__((weak));
+extern "C" void PCINT2_vect() __attribute__((weak));
+
+Simulator &simulator()
+{
+  static Simulator instance;
+  return instance;
+}
+
+// Constructor
+Simulator::Simulator()
+{
+  m_nanos = 0ULL;
+
+  memset(m_pinMode, 0, sizeof(m_pinMode));
+  memset(m_pinOutput, 0, sizeof(m_pinOutput));
+  memset(m_digitalInput, 0, sizeof(m_digitalInput));
+  memset(m_analogInput, 0, sizeof(m_analogInput));
+  memset(m_pinInterrupt, 0, sizeof(m_pinInterrupt));
+  memset(m_pinInterruptMode, 0, sizeof(m_pinInterruptMode));
+
+  m_spiDivider = 4; // Default clock of the SPI library
+  memset(m_maxShift, 0, sizeof(m_maxShift));
+  memset(m_maxDigits, 0, sizeof(m_maxDigits));
+  memset(m_maxIntensity, 0, sizeof(m_maxIntensity));
+  memset(m_maxShutdown, 0, sizeof(m_maxShutdown));
+
+  resetCounters();
+}
+
+void Simulator::resetCounters()
+{
+  memset(&counters, 0, sizeof(counters));
+}
+
+// ---------- Pins ----------
+
+void Simulator::setPinMode(uint8_t pin, uint8_t mode)
+{
+  if(pin < SIM_PIN_COUNT)
+    m_pinMode[pin] = mode;
+}
+
+void Simulator::writePin(uint8_t pin, uint8_t val)
+{
+  if(pin >= SIM_PIN_COUNT)
+    return;
+
+  // The MAX7219 latches its shift register on the rising edge of LOAD
+  if(pin == PIN_LOAD && m_pinOutput[pin] == 0 && val != 0)
+    latchChain();
+
+  m_pinOutput[pin] = val ? 1 : 0;
+}
+
+int Simulator::readPin(uint8_t pin)
+{
+  if(pin >= SIM_PIN_COUNT)
+    return 0;
+
+  return m_pinMode[pin] == 1 ? m_pinOutput[pin] : m_digitalInput[pin];
+}
+
+int Simulator::readAnalog(uint8_t pin)
+{
+  counters.analogReads++;
+
+  return pin < SIM_PIN_COUNT ? m_analogInput[pin] : 0;
+}
+
+void Simulator::setDigitalInput(uint8_t pin, uint8_t val)
+{
+  if(pin >= SIM_PIN_COUNT)
+    return;
+
+  uint8_t old = m_digitalInput[pin];
+
+  m_digitalInput[pin] = val ? 1 : 0;
+
+  if(old == m_digitalInput[pin])
+    return;
+
+  if(m_pinInterrupt[pin] != NULL && (m_pinInterruptMode[pin] == CHANGE || (m_pinInterruptMode[pin] == RISING) == (m_digitalInput[pin] == 1)))
+    m_pinInterrupt[pin]();
+
+  // Port D (pins 0-7), port B (pins 8-13) then port C (pins 14-21)
+  if(pin <= 7 && (simPCICR & 0x04) && (simPCMSK2 & (1 << pin)) && PCINT2_vect != NULL)
+    PCINT2_vect();
+  else if(pin >= 8 && pin <= 13 && (simPCICR & 0x01) && (simPCMSK0 & (1 << (pin - 8))) && PCINT0_vect != NULL)
+    PCINT0_vect();
+  else if(pin >= 14 && pin <= 21 && (simPCICR & 0x02) && (simPCMSK1 & (1 << (pin - 14))) && PCINT1_vect != NULL)
+    PCINT1_vect();
+}
+
+void Simulator::setPinInterrupt(uint8_t pin, void (*handler)(), int mode)
+{
+  if(pin < SIM_PIN_COUNT)
+  {
+    m_pinInterrupt[pin] = handler;
+    m_pinInterruptMode[pin] = mode;
+  }
+}
+
+void Simulator::setAnalogInput(uint8_t pin, int val)
+{
+  if(pin < SIM_PIN_COUNT)
+    m_analogInput[pin] = val < 0 ? 0 : (val > 1023 ? 1023 : val);
+}
+
+// ---------- MAX7219 chain ----------
+
+// Shift one byte into the chain (index 0 is the most recent byte)
+void Simulator::spiTransfer(uint8_t val)
+{
+  counters.spiBytes++;
+  advanceNanos(8ULL * m_spiDivider * 1000000000ULL / 16000000ULL);
+
+  memmove(m_maxShift + 1, m_maxShift, sizeof(m_maxShift) - 1);
+  m_maxShift[0] = val;
+}
+
+// Each driver executes the 16 bit word sitting in its shift register
+void Simulator::latchChain()
+{
+  counters.spiTransactions++;
+
+  for(int i = 0 ; i < SIM_DRIVERS ; i++)
+  {
+    uint8_t reg = m_maxShift[i * 2 + 1] & 0x0F;
+    uint8_t val = m_maxShift[i * 2];
+
+    if(reg >= 1 && reg <= SIM_MAX_REG_DIGIT7)
+      m_maxDigits[i][reg - 1] = val;
+    else if(reg == SIM_MAX_REG_INTENSITY)
+      m_maxIntensity[i] = val & 0x0F;
+    else if(reg == SIM_MAX_REG_SHUTDOWN)
+      m_maxShutdown[i] = val & 0x01;
+  }
+}
+
+// Print what the LEDs are currently showing
+void Simulator::render(FILE *out) const
+{
+  int driverOfBlock[SIM_DRIVERS];
+
+  for(int i = 0 ; i < SIM_DRIVERS ; i++)
+    driverOfBlock[displayChainBlock(i)] = i;
+
+  for(int y = 0 ; y < DISPLAY_HEIGHT ; y++)
+  {
+    for(int x = 0 ; x < DISPLAY_WIDTH ; x++)
+    {
+      int driver = driverOfBlock[(y / 8) * DISPLAY_BLOCKS_X + x / 8];
+      bool on = m_maxShutdown[driver] && (m_maxDigits[driver][y % 8] & (0x80 >> (x % 8)));
+
+      fputs(on ? "X " : ". ", out);
+    }
+
+    fputc('\n', out);
+  }
+}
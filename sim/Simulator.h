@@ -0,0 +1,89 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * Simulator.h : Virtual hardware shared by the mocked Arduino libraries (clock, pins, bus counters).
+ */
+
+#ifndef SIM_SIMULATOR
+#define SIM_SIMULATOR
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "Display.h" // Geometry of the MAX7219 chain
+
+#define SIM_PIN_COUNT 22
+#define SIM_DRIVERS DISPLAY_DRIVERS
+
+// Bus activity counters, reset with Simulator::resetCounters()
+struct SimCounters
+{
+  unsigned long spiBytes;
+  unsigned long spiTransactions; // Rising edges of the MAX7219 LOAD pin
+  unsigned long i2cTransactions;
+  unsigned long i2cBytes;
+  unsigned long oneWireResets;
+  unsigned long oneWireBytes;
+  unsigned long eepromReads;
+  unsigned long eepromWrites;
+  unsigned long analogReads;
+  unsigned long serialBytes; // Received
+  unsigned long serialOverruns; // Received while the receive buffer was full
+  unsigned long loopIterations;
+};
+
+class Simulator
+{
+  public:
+    Simulator();
+
+    // Virtual clock (nanosecond resolution, so that fast SPI transfers add up correctly)
+    uint64_t now() const { return m_nanos / 1000ULL; }
+    uint64_t nowNanos() const { return m_nanos; }
+    void advanceMicros(uint64_t us) { m_nanos += us * 1000ULL; }
+    void advanceNanos(uint64_t ns) { m_nanos += ns; }
+
+    // Pins
+    void setPinMode(uint8_t pin, uint8_t mode);
+    void writePin(uint8_t pin, uint8_t val);
+    int readPin(uint8_t pin);
+    int readAnalog(uint8_t pin);
+    void setDigitalInput(uint8_t pin, uint8_t val);
+    void setAnalogInput(uint8_t pin, int val);
+    void setPinInterrupt(uint8_t pin, void (*handler)(), int mode);
+
+    // MAX7219 chain connected to the SPI bus
+    void spiTransfer(uint8_t val);
+    void setSpiClockDivider(uint8_t divider) { m_spiDivider = divider; }
+    uint8_t getSpiClockDivider() const { return m_spiDivider; }
+    uint8_t getLedRegister(int driver, int digit) const { return m_maxDigits[driver][digit]; }
+    uint8_t getIntensity(int driver) const { return m_maxIntensity[driver]; }
+    void render(FILE *out) const;
+
+    SimCounters counters;
+    void resetCounters();
+
+  private:
+    uint64_t m_nanos;
+
+    uint8_t m_pinMode[SIM_PIN_COUNT];
+    uint8_t m_pinOutput[SIM_PIN_COUNT];
+    uint8_t m_digitalInput[SIM_PIN_COUNT];
+    int m_analogInput[SIM_PIN_COUNT];
+    void (*m_pinInterrupt[SIM_PIN_COUNT])();
+    int m_pinInterruptMode[SIM_PIN_COUNT];
+
+    uint8_t m_spiDivider;
+    uint8_t m_maxShift[SIM_DRIVERS * 2]; // Shift registers of the chain, first device first
+    uint8_t m_maxDigits[SIM_DRIVERS][8];
+    uint8_t m_maxIntensity[SIM_DRIVERS];
+    uint8_t m_maxShutdown[SIM_DRIVERS];
+
+    void latchChain();
+};
+
+// Global simulator instance (function-local static so it is usable from global constructors)
+Simulator &simulator();
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * Wire.cpp : Implements the Wire library stand-in and a DS3231 RTC running on the virtual clock.
+ */
+
+#include "Wire.h"
+#include "Simulator.h"
+
+// 100 kHz bus : 9 clocks per byte
+#define SIM_I2C_BYTE_US 90ULL
+#define SIM_I2C_START_STOP_US 20ULL
+
+#define SIM_DS3231_ADDR 0x68
+#define SIM_DS3231_REGS 0x13
+#define SIM_DS3231_CONTROL 0x0E
+
+TwoWire Wire;
+
+// ---------- DS3231 ----------
+
+struct SimRTC
+{
+  int year, month, dom, dow, hours, mins, secs;
+  uint64_t lastTick; // Virtual time of the last second boundary (us)
+  uint8_t regs[SIM_DS3231_REGS];
+  uint8_t pointer;
+  int squareWavePin; // -1 if SQW/INT is not wired
+};
+
+static SimRTC simRtc = {12, 5, 1, 2, 12, 0, 0, 0ULL, {0}, 0, -1};
+
+static uint8_t simToBcd(int val)
+{
+  return (uint8_t)(((val / 10) << 4) | (val % 10));
+}
+
+static int simFromBcd(uint8_t val)
+{
+  return (val >> 4) * 10 + (val & 0x0F);
+}
+
+static int simDaysInMonth(int month, int year)
+{
+  static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+  if(month == 2 && year % 4 == 0)
+    return 29;
+
+  return days[(month - 1) % 12];
+}
+
+// Catch up with the virtual clock, one second at a time
+static void simRtcUpdate()
+{
+  uint64_t now = simulator().now();
+
+  while(now - simRtc.lastTick >= 1000000ULL)
+  {
+    simRtc.lastTick += 1000000ULL;
+
+    if(++simRtc.secs < 60)
+      continue;
+    simRtc.secs = 0;
+    if(++simRtc.mins < 60)
+      continue;
+    simRtc.mins = 0;
+    if(++simRtc.hours < 24)
+      continue;
+    simRtc.hours = 0;
+    simRtc.dow = simRtc.dow % 7 + 1;
+    if(++simRtc.dom <= simDaysInMonth(simRtc.month, simRtc.year))
+      continue;
+    simRtc.dom = 1;
+    if(++simRtc.month <= 12)
+      continue;
+    simRtc.month = 1;
+    simRtc.year = (simRtc.year + 1) % 100;
+  }
+
+  simRtc.regs[0] = simToBcd(simRtc.secs);
+  simRtc.regs[1] = simToBcd(simRtc.mins);
+  simRtc.regs[2] = simToBcd(simRtc.hours);
+  simRtc.regs[3] = simToBcd(simRtc.dow);
+  simRtc.regs[4] = simToBcd(simRtc.dom);
+  simRtc.regs[5] = simToBcd(simRtc.month);
+  simRtc.regs[6] = simToBcd(simRtc.year);
+}
+
+// Writing the time registers restarts the one second countdown
+static void simRtcWrite(uint8_t reg, uint8_t val)
+{
+  if(reg >= SIM_DS3231_REGS)
+    return;
+
+  simRtc.regs[reg] = val;
+
+  switch(reg)
+  {
+    case 0: simRtc.secs = simFromBcd(val & 0x7F); simRtc.lastTick = simulator().now(); break;
+    case 1: simRtc.mins = simFromBcd(val & 0x7F); break;
+    case 2: simRtc.hours = simFromBcd(val & 0x3F); break;
+    case 3: simRtc.dow = val & 0x07; break;
+    case 4: simRtc.dom = simFromBcd(val & 0x3F); break;
+    case 5: simRtc.month = simFromBcd(val & 0x1F); break;
+    case 6: simRtc.year = simFromBcd(val); break;
+  }
+}
+
+void simSetRTC(int year, int month, int dom, int dow, int hours, int mins, int secs)
+{
+  simRtc.year = year % 100;
+  simRtc.month = month;
+  simRtc.dom = dom;
+  simRtc.dow = dow;
+  simRtc.hours = hours;
+  simRtc.mins = mins;
+  simRtc.secs = secs;
+  simRtc.lastTick = simulator().now();
+  simRtc.regs[SIM_DS3231_CONTROL] = 0x1C; // Power-on value : INTCN set, no square wave
+}
+
+void simSetRTCSquareWavePin(int pin)
+{
+  simRtc.squareWavePin = pin;
+}
+
+// SQW/INT falls on each second boundary and rises half a second later when INTCN = 0 and RS2-RS1 = 00 (1 Hz)
+void simUpdateRTC()
+{
+  if(simRtc.squareWavePin < 0)
+    return;
+
+  simRtcUpdate();
+
+  uint8_t control = simRtc.regs[SIM_DS3231_CONTROL];
+  bool squareWave = (control & 0x1C) == 0x00;
+
+  simulator().setDigitalInput(simRtc.squareWavePin, squareWave ? simulator().now() - simRtc.lastTick >= 500000ULL : HIGH);
+}
+
+// ---------- TwoWire ----------
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+  m_address = address;
+  m_txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t val)
+{
+  if(m_txLength >= SIM_WIRE_BUFFER_LENGTH)
+    return 0;
+
+  m_txBuffer[m_txLength++] = val;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity)
+{
+  size_t written = 0;
+
+  while(written < quantity && write(data[written]))
+    written++;
+
+  return written;
+}
+
+// Returns 0 on success, 2 when the address is not acknowledged (same codes as the real library)
+uint8_t TwoWire::endTransmission(uint8_t sendStop)
+{
+  (void)sendStop;
+
+  simulator().counters.i2cTransactions++;
+  simulator().counters.i2cBytes += m_txLength + 1;
+  simulator().advanceMicros(SIM_I2C_START_STOP_US + SIM_I2C_BYTE_US * (m_txLength + 1));
+
+  if(m_address != SIM_DS3231_ADDR)
+    return 2;
+
+  simRtcUpdate();
+
+  if(m_txLength > 0)
+  {
+    simRtc.pointer = m_txBuffer[0] % SIM_DS3231_REGS;
+
+    for(int i = 1 ; i < m_txLength ; i++)
+    {
+      simRtcWrite(simRtc.pointer, m_txBuffer[i]);
+      simRtc.pointer = (simRtc.pointer + 1) % SIM_DS3231_REGS;
+    }
+  }
+
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+  m_rxLength = 0;
+  m_rxIndex = 0;
+
+  if(quantity > SIM_WIRE_BUFFER_LENGTH)
+    quantity = SIM_WIRE_BUFFER_LENGTH;
+
+  simulator().counters.i2cTransactions++;
+  simulator().counters.i2cBytes += quantity + 1;
+  simulator().advanceMicros(SIM_I2C_START_STOP_US + SIM_I2C_BYTE_US * (quantity + 1));
+
+  if(address != SIM_DS3231_ADDR)
+    return 0;
+
+  simRtcUpdate();
+
+  for(int i = 0 ; i < quantity ; i++)
+  {
+    m_rxBuffer[m_rxLength++] = simRtc.regs[simRtc.pointer];
+    simRtc.pointer = (simRtc.pointer + 1) % SIM_DS3231_REGS;
+  }
+
+  return m_rxLength;
+}
+
+int TwoWire::available()
+{
+  return m_rxLength - m_rxIndex;
+}
+
+int TwoWire::read()
+{
+  return m_rxIndex < m_rxLength ? m_rxBuffer[m_rxIndex++] : -1;
+}
@@ -0,0 +1,46 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * Wire.h : Stand-in for the Wire library, wired to a simulated DS3231 (Chronodot) RTC.
+ */
+
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include "Arduino.h"
+
+#define SIM_WIRE_BUFFER_LENGTH 32
+
+class TwoWire
+{
+  public:
+    void begin() {}
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+    uint8_t endTransmission(uint8_t sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity);
+    uint8_t requestFrom(int address, int quantity) { return requestFrom((uint8_t)address, (uint8_t)quantity); }
+    size_t write(uint8_t val);
+    size_t write(const uint8_t *data, size_t quantity);
+    int available();
+    int read();
+
+  private:
+    uint8_t m_address;
+    uint8_t m_txBuffer[SIM_WIRE_BUFFER_LENGTH];
+    uint8_t m_txLength;
+    uint8_t m_rxBuffer[SIM_WIRE_BUFFER_LENGTH];
+    uint8_t m_rxLength;
+    uint8_t m_rxIndex;
+};
+
+extern TwoWire Wire;
+
+// Simulated DS3231, advanced by the virtual clock
+void simSetRTC(int year, int month, int dom, int dow, int hours, int mins, int secs);
+
+// Input pin wired to the SQW/INT output, driven by simUpdateRTC()
+void simSetRTCSquareWavePin(int pin);
+void simUpdateRTC();
+
+#endif
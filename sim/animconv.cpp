@@ -0,0 +1,74 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * animconv.cpp : Encodes text frames into the animation format of Animation::play() (see Animation.h) and
+ *                prints it as a PROGMEM array : ./animconv NAME < frames.txt > NAME.h
+ *
+ * Input : text frames (see textframes.h).
+ */
+
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "Animation.h"
+#include "textframes.h"
+#include "settings.h"
+
+// Adds a frame, as a delta if it is smaller than the keyframe
+static void encodeFrame(Bytes &out, const uint8_t *prev, const uint8_t *cur, int duration, int &keyframes)
+{
+  Bytes delta;
+
+  if(prev != NULL)
+    delta = encodeDelta(prev, cur);
+
+  boolean key = prev == NULL || delta.size() >= ANIMATION_FRAME_BYTES;
+
+  out.push_back(key ? ANIMATION_KEYFRAME : ANIMATION_DELTA);
+  out.push_back((uint8_t)(duration & 0xFF));
+  out.push_back((uint8_t)(duration >> 8));
+
+  if(key)
+  {
+    out.insert(out.end(), cur, cur + ANIMATION_FRAME_BYTES);
+    keyframes++;
+  }
+  else
+    out.insert(out.end(), delta.begin(), delta.end());
+}
+
+int main(int argc, char *argv[])
+{
+  if(argc != 2)
+  {
+    fprintf(stderr, "Usage : %s NAME < frames.txt > NAME.h\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<TextFrame> frames;
+
+  if(!readTextFrames(stdin, frames))
+    return 1;
+
+  Bytes out;
+  int count = (int)frames.size(), keyframes = 0;
+
+  out.push_back(DISPLAY_WIDTH);
+  out.push_back(DISPLAY_HEIGHT);
+
+  for(int i = 0 ; i < count ; i++)
+    encodeFrame(out, i > 0 ? frames[i - 1].bits : NULL, frames[i].bits, frames[i].duration, keyframes);
+
+  out.push_back(ANIMATION_END);
+
+  printf("// Generated by animconv : %d frames (%d keyframes), %d bytes instead of %d\n\n",
+    count, keyframes, (int)out.size(), count * ANIMATION_FRAME_BYTES);
+  printf("const byte %s[] PROGMEM =\n{", argv[1]);
+
+  for(size_t i = 0 ; i < out.size() ; i++)
+    printf("%s0x%02X%s", i % 12 == 0 ? "\n  " : "", out[i], i + 1 < out.size() ? ", " : "\n");
+
+  printf("};\n");
+
+  return 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * bench.cpp : Display flush benchmark. Drives representative workloads through Display::display()
+ *             at each SPI clock and reports the bus cost per flush.
+ */
+
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "Simulator.h"
+#include "Display.h"
+#include "GameOfLife.h"
+#include "InputHandler.h"
+#include "TimeHandler.h"
+#include "Marquee.h"
+#include "Wire.h"
+#include "Animation.h"
+
+#include "spinner.h" // Generated by animconv from animations/spinner.txt
+
+#define BENCH_FLUSHES 60
+
+InputHandler inputs;
+Display disp(&inputs);
+GameOfLife gol(&disp);
+TimeHandler rtc(&disp, &inputs);
+Marquee marquee(&disp);
+Animation animation(&disp);
+
+// Bus cost of the flushes of one workload
+struct BenchResult
+{
+  unsigned long flushes;
+  unsigned long bytes;
+  unsigned long transactions;
+  uint64_t micros;
+};
+
+// Flush the display and add the cost to the result
+static void measureFlush(BenchResult &result)
+{
+  Simulator &sim = simulator();
+  unsigned long bytes = sim.counters.spiBytes;
+  unsigned long transactions = sim.counters.spiTransactions;
+  uint64_t start = sim.now();
+
+  disp.display();
+  disp.waitFlush();
+
+  result.flushes++;
+  result.bytes += sim.counters.spiBytes - bytes;
+  result.transactions += sim.counters.spiTransactions - transactions;
+  result.micros += sim.now() - start;
+}
+
+// Light everything, then measure the flush of clear()
+static void benchClear(BenchResult &result)
+{
+  for(int i = 0 ; i < BENCH_FLUSHES ; i++)
+  {
+    for(int y = 0 ; y < DISPLAY_HEIGHT ; y++)
+      disp.setRow(y, DISPLAY_ROW_MASK);
+    disp.display();
+
+    disp.clear();
+    measureFlush(result);
+  }
+}
+
+// One Game of Life generation per flush
+static void benchGameOfLife(BenchResult &result)
+{
+  randomSeed(42);
+  disp.clear();
+  gol.initialize();
+  disp.display();
+
+  for(int i = 0 ; i < BENCH_FLUSHES ; i++)
+  {
+    gol.getNextStep();
+    measureFlush(result);
+    gol.autoReset();
+    disp.display();
+  }
+}
+
+// One second of the clock mode per flush
+static void benchClock(BenchResult &result)
+{
+  disp.clear();
+  rtc.updateTime();
+  rtc.displayTime();
+  disp.display();
+
+  for(int i = 0 ; i < BENCH_FLUSHES ; i++)
+  {
+    delay(1000UL); // Lets the RTC square wave tick
+    rtc.updateTime();
+    rtc.displayTime();
+    measureFlush(result);
+  }
+}
+
+// A single seven segment digit changing
+static void benchDigit(BenchResult &result)
+{
+  disp.clear();
+  disp.display();
+
+  for(int i = 0 ; i < BENCH_FLUSHES ; i++)
+  {
+    disp.setDigit(5, 5, i % 10);
+    measureFlush(result);
+  }
+}
+
+// One column of marquee scrolling per flush
+static void benchMarquee(BenchResult &result)
+{
+  disp.clear();
+  marquee.start("12:34  01/05/12", (DISPLAY_HEIGHT - FONT_HEIGHT) / 2);
+  disp.display();
+
+  for(int i = 0 ; i < BENCH_FLUSHES ; i++)
+  {
+    marquee.step();
+    measureFlush(result);
+  }
+}
+
+// One frame of the example encoded animation per flush, played again when it ends
+static void benchAnimation(BenchResult &result)
+{
+  disp.clear();
+  disp.display();
+
+  for(int i = 0 ; i < BENCH_FLUSHES ; i++)
+  {
+    if(!animation.isRunning())
+      animation.play(spinner);
+
+    while(!animation.update())
+      simulator().advanceMicros(1000ULL);
+
+    measureFlush(result);
+  }
+}
+
+int main()
+{
+  static const char *names[6] = {"full clear", "GoL generation", "clock tick", "digit change", "marquee step", "animation frame"};
+  static void (*workloads[6])(BenchResult &) = {benchClear, benchGameOfLife, benchClock, benchDigit, benchMarquee, benchAnimation};
+
+  #ifdef PIN_RTC_SQW
+    simSetRTCSquareWavePin(PIN_RTC_SQW);
+  #endif
+
+  rtc.initializeRTC();
+
+  printf("%d x %d display, %d drivers, %d flushes per workload\n\n", DISPLAY_WIDTH, DISPLAY_HEIGHT, DISPLAY_DRIVERS, BENCH_FLUSHES);
+  printf("%10s  %-16s %12s %14s %12s\n", "SPI clock", "workload", "bytes/flush", "loads/flush", "us/flush");
+
+  for(unsigned long clock = F_CPU / 2 ; clock >= F_CPU / 128 ; clock /= 2)
+  {
+    disp.setSpiClock(clock);
+
+    for(int i = 0 ; i < 6 ; i++)
+    {
+      BenchResult result = {0UL, 0UL, 0UL, 0ULL};
+
+      workloads[i](result);
+
+      printf("%7lu kHz  %-16s %12.1f %14.1f %12.1f\n", disp.getSpiClock() / 1000UL, names[i],
+        (double)result.bytes / result.flushes, (double)result.transactions / result.flushes, (double)result.micros / result.flushes);
+    }
+
+    printf("\n");
+  }
+
+  return 0;
+}
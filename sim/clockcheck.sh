@@ -0,0 +1,50 @@
+#!/bin/sh
+# Host-side simulator of the 16 * 16 LED matrix
+# ---------
+# clockcheck.sh : Runs matrix-sim through the time adjustment, with and without the RTC square wave, and checks
+#                 that the clock goes on (make clockcheck). A run that does not end within TIMEOUT real seconds
+#                 has hung.
+
+TIMEOUT=${TIMEOUT:-20}
+OUT=obj/clockcheck.txt
+FAILED=0
+
+mkdir -p obj
+
+# Prints the LEDs after the given virtual seconds, with the other arguments passed to matrix-sim
+render()
+{
+  AT=$1
+  shift
+  timeout "$TIMEOUT" ./matrix-sim --seconds "$AT" --render "$@" > "$OUT" || return 1
+  tail -n 16 "$OUT"
+}
+
+# The clock moves on between the two renders
+check()
+{
+  NAME=$1
+  shift
+  FIRST=$(render 10.5 "$@")
+  [ $? -eq 0 ] && SECOND=$(render 11.5 "$@")
+
+  if [ $? -ne 0 ] || [ -z "$FIRST" ] || [ "$FIRST" = "$SECOND" ]; then
+    echo "$NAME : FAILED"
+    FAILED=1
+  else
+    echo "$NAME : OK"
+  fi
+}
+
+# Settings (long MODE), time adjustment (PLUS), kept for more than a second on the day of month, then each field
+# validated in turn (MODE)
+ADJUST="--press mode@500:1500 --press plus@3000 --press plus@4500 --press mode@5000 --press mode@5500
+  --press mode@6000 --press mode@6500 --press mode@7000 --press mode@7500"
+
+check "time adjustment" $ADJUST
+
+# Board without the square wave wired (time mode, then the adjustment) : the seconds are counted with millis()
+check "no square wave" --no-sqw --press mode@1000
+check "no square wave, time adjustment" --no-sqw $ADJUST
+
+exit $FAILED
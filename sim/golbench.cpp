@@ -0,0 +1,313 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * golbench.cpp : Game of Life benchmark. Checks GameOfLife::getNextStep() against a cell by cell reference
+ *                for each rule preset, on both topologies, then compares its cost per cell with the fixed
+ *                B3/S23 update it replaced. Fails if the B3/S23 path of the engine is measurably slower
+ *                than the fixed update on the same world with dead edges.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "Arduino.h"
+#include "Display.h"
+#include "GameOfLife.h"
+#include "InputHandler.h"
+
+#define GOLBENCH_WORLDS 50 // Random worlds checked per rule and topology
+#define GOLBENCH_CHECK_STEPS 100 // Generations checked per world
+#define GOLBENCH_STEPS 20000L // Generations timed per case
+#define GOLBENCH_RUNS 101 // Best of
+#define GOLBENCH_TOLERANCE 1.10 // Slowdown of the B3/S23 path above which the benchmark fails (timing noise)
+
+// FNV-1a, as in GameOfLife.cpp
+#define GOLBENCH_HASH_BASIS 2166136261UL
+#define GOLBENCH_HASH_PRIME 16777619UL
+
+InputHandler inputs;
+Display disp(&inputs);
+GameOfLife gol(&disp);
+
+// Rules of the presets, in the order of GameOfLife.cpp
+static const char *presetNames[GOL_RULE_PRESETS] =
+{
+  "B3/S23", "B36/S23", "B2/S", "B3678/S34678", "B368/S245", "B1357/S1357", "B3/S012345678", "B35678/S5678"
+};
+
+// Cycle detection of the fixed update, as in GameOfLife
+static unsigned long fixedHistory[GOL_HISTORY];
+static byte fixedHistoryIndex = 0, fixedHistoryCount = 0, fixedPeriod = 0;
+
+// Fixed B3/S23 update with dead edges, as getNextStep() was before the rule engine
+static void fixedNextStep()
+{
+  DisplayRow aboveOnes = 0, aboveTwos = 0;
+  DisplayRow cur = disp.getRow(0);
+  DisplayRow curLeft = (cur << 1) & DISPLAY_ROW_MASK, curRight = cur >> 1;
+  DisplayRow curOnes = curLeft ^ cur ^ curRight;
+  DisplayRow curTwos = (curLeft & cur) | (curRight & (curLeft ^ cur));
+  unsigned long hash = GOLBENCH_HASH_BASIS;
+
+  for(int y = 0 ; y < DISPLAY_HEIGHT ; y++)
+  {
+    DisplayRow below = (y < DISPLAY_HEIGHT - 1) ? disp.getRow(y + 1) : 0;
+    DisplayRow belowLeft = (below << 1) & DISPLAY_ROW_MASK, belowRight = below >> 1;
+    DisplayRow belowOnes = belowLeft ^ below ^ belowRight;
+    DisplayRow belowTwos = (belowLeft & below) | (belowRight & (belowLeft ^ below));
+
+    DisplayRow sideOnes = curLeft ^ curRight;
+    DisplayRow sideTwos = curLeft & curRight;
+
+    DisplayRow bit0 = aboveOnes ^ sideOnes ^ belowOnes;
+    DisplayRow carry0 = (aboveOnes & sideOnes) | (belowOnes & (aboveOnes ^ sideOnes));
+
+    DisplayRow sum1 = aboveTwos ^ sideTwos ^ belowTwos;
+    DisplayRow carry1 = (aboveTwos & sideTwos) | (belowTwos & (aboveTwos ^ sideTwos));
+    DisplayRow bit1 = sum1 ^ carry0;
+    DisplayRow bit2 = carry1 ^ (sum1 & carry0);
+
+    DisplayRow next = bit1 & ~bit2 & (bit0 | cur);
+    disp.setRow(y, next);
+    hash = (hash ^ next) * GOLBENCH_HASH_PRIME;
+
+    aboveOnes = curOnes; aboveTwos = curTwos;
+    cur = below;
+    curLeft = belowLeft; curRight = belowRight;
+    curOnes = belowOnes; curTwos = belowTwos;
+  }
+
+  for(byte p = 1 ; p <= fixedHistoryCount && fixedPeriod == 0 ; p++)
+  {
+    if(fixedHistory[(fixedHistoryIndex + GOL_HISTORY - p) % GOL_HISTORY] == hash)
+      fixedPeriod = p;
+  }
+
+  fixedHistory[fixedHistoryIndex] = hash;
+  fixedHistoryIndex = (fixedHistoryIndex + 1) % GOL_HISTORY;
+
+  if(fixedHistoryCount < GOL_HISTORY)
+    fixedHistoryCount++;
+}
+
+// Cell by cell update of world, with the rule given as birth and survival masks (bit n : n neighbours)
+static void referenceNextStep(DisplayRow world[DISPLAY_HEIGHT], unsigned int birth, unsigned int survival, bool wrap)
+{
+  DisplayRow next[DISPLAY_HEIGHT];
+
+  for(int y = 0 ; y < DISPLAY_HEIGHT ; y++)
+  {
+    next[y] = 0;
+
+    for(int x = 0 ; x < DISPLAY_WIDTH ; x++)
+    {
+      int count = 0;
+
+      for(int dy = -1 ; dy <= 1 ; dy++)
+      {
+        for(int dx = -1 ; dx <= 1 ; dx++)
+        {
+          int nx = x + dx, ny = y + dy;
+
+          if((dx == 0 && dy == 0) || (!wrap && (nx < 0 || nx >= DISPLAY_WIDTH || ny < 0 || ny >= DISPLAY_HEIGHT)))
+            continue;
+
+          nx = (nx + DISPLAY_WIDTH) % DISPLAY_WIDTH;
+          ny = (ny + DISPLAY_HEIGHT) % DISPLAY_HEIGHT;
+          count += (world[ny] >> nx) & 1;
+        }
+      }
+
+      bool alive = (world[y] >> x) & 1;
+
+      if(alive ? (survival >> count) & 1 : (birth >> count) & 1)
+        next[y] |= (DisplayRow)1 << x;
+    }
+  }
+
+  for(int y = 0 ; y < DISPLAY_HEIGHT ; y++)
+    world[y] = next[y];
+}
+
+// Birth and survival masks of a B/S rule
+static void parseRule(const char *rule, unsigned int &birth, unsigned int &survival)
+{
+  unsigned int *set = &birth;
+
+  birth = survival = 0;
+
+  for(const char *c = rule ; *c != '\0' ; c++)
+  {
+    if(*c == 'B')
+      set = &birth;
+    else if(*c == 'S')
+      set = &survival;
+    else if(*c >= '0' && *c <= '8')
+      *set |= 1 << (*c - '0');
+  }
+}
+
+static void randomWorld(DisplayRow world[DISPLAY_HEIGHT])
+{
+  for(int y = 0 ; y < DISPLAY_HEIGHT ; y++)
+  {
+    world[y] = 0;
+
+    for(int x = 0 ; x < DISPLAY_WIDTH ; x++)
+    {
+      if(random(3) == 0)
+        world[y] |= (DisplayRow)1 << x;
+    }
+
+    disp.setRow(y, world[y]);
+  }
+}
+
+// Number of rows of getNextStep() that differ from the reference
+static int check(byte preset, bool wrap)
+{
+  unsigned int birth, survival;
+  int errors = 0;
+
+  parseRule(presetNames[preset], birth, survival);
+  gol.setRulePreset(preset);
+  gol.setWrap(wrap);
+
+  for(int w = 0 ; w < GOLBENCH_WORLDS ; w++)
+  {
+    DisplayRow world[DISPLAY_HEIGHT];
+
+    randomWorld(world);
+
+    for(int s = 0 ; s < GOLBENCH_CHECK_STEPS ; s++)
+    {
+      gol.getNextStep();
+      referenceNextStep(world, birth, survival, wrap);
+
+      for(int y = 0 ; y < DISPLAY_HEIGHT ; y++)
+      {
+        if(disp.getRow(y) != world[y])
+        {
+          errors++;
+          disp.setRow(y, world[y]); // Go on from the right world
+        }
+      }
+    }
+  }
+
+  return errors;
+}
+
+static double seconds()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Time per cell (ns) of GOLBENCH_STEPS generations from the same random world
+static double measureOnce(bool fixed)
+{
+  DisplayRow world[DISPLAY_HEIGHT];
+
+  randomSeed(1);
+  randomWorld(world);
+
+  double start = seconds();
+
+  for(long s = 0 ; s < GOLBENCH_STEPS ; s++)
+  {
+    if(fixed)
+      fixedNextStep();
+    else
+      gol.getNextStep();
+  }
+
+  return (seconds() - start) * 1e9 / GOLBENCH_STEPS / (DISPLAY_WIDTH * DISPLAY_HEIGHT);
+}
+
+// Best of GOLBENCH_RUNS, with the rule and the topology currently set
+static double measure(bool fixed)
+{
+  double best = 0.0;
+
+  for(int run = 0 ; run < GOLBENCH_RUNS ; run++)
+  {
+    double ns = measureOnce(fixed);
+
+    if(run == 0 || ns < best)
+      best = ns;
+  }
+
+  return best;
+}
+
+// Best of GOLBENCH_RUNS of the fixed update and of the engine running B3/S23 with dead edges, one run of each
+// in turn so that the host does not favour either
+static void measureConway(double &fixed, double &engine)
+{
+  gol.setRulePreset(0);
+  gol.setWrap(false);
+
+  for(int run = 0 ; run < GOLBENCH_RUNS ; run++)
+  {
+    double f = measureOnce(true);
+    double e = measureOnce(false);
+
+    if(run == 0 || f < fixed)
+      fixed = f;
+
+    if(run == 0 || e < engine)
+      engine = e;
+  }
+}
+
+int main()
+{
+  int failures = 0;
+
+  printf("Correctness : %d random worlds, %d generations each, against a cell by cell reference\n\n",
+    GOLBENCH_WORLDS, GOLBENCH_CHECK_STEPS);
+  printf("%-16s %12s %12s\n", "rule", "dead edges", "torus");
+
+  for(byte preset = 0 ; preset < GOL_RULE_PRESETS ; preset++)
+  {
+    int flat = check(preset, false);
+    int torus = check(preset, true);
+
+    printf("%-16s %12s %12s\n", presetNames[preset], flat == 0 ? "ok" : "WRONG", torus == 0 ? "ok" : "WRONG");
+    failures += flat + torus;
+  }
+
+  printf("\nCost per cell : %ld generations of %d * %d cells, best of %d (host time, not ATmega328 time)\n\n",
+    GOLBENCH_STEPS, DISPLAY_WIDTH, DISPLAY_HEIGHT, GOLBENCH_RUNS);
+  printf("%-16s %12s %12s\n", "rule", "dead edges", "torus");
+
+  double fixed = 0.0, engine = 0.0;
+
+  measureConway(fixed, engine);
+  printf("%-16s %9.2f ns %12s\n", "fixed B3/S23", fixed, "-");
+
+  for(byte preset = 0 ; preset < GOL_RULE_PRESETS ; preset++)
+  {
+    gol.setRulePreset(preset);
+    gol.setWrap(false);
+    double flat = preset == 0 ? engine : measure(false);
+    gol.setWrap(true);
+    double torus = measure(false);
+
+    printf("%-16s %9.2f ns %9.2f ns\n", presetNames[preset], flat, torus);
+  }
+
+  printf("\nB3/S23 with dead edges : %.2f times the cost of the fixed update (limit %.2f)\n", engine / fixed, GOLBENCH_TOLERANCE);
+
+  if(engine > fixed * GOLBENCH_TOLERANCE)
+  {
+    printf("SLOWER than the fixed update\n");
+    failures++;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * hostserial.cpp : Opens the serial ports and pseudo-terminals of the host.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "hostserial.h"
+
+// Termios constant of a baud rate, B0 if there is none
+static speed_t speedOf(unsigned long baud)
+{
+  static const struct { unsigned long baud; speed_t speed; } speeds[] =
+  {
+    {9600UL, B9600}, {19200UL, B19200}, {38400UL, B38400}, {57600UL, B57600}, {115200UL, B115200},
+    {230400UL, B230400}, {460800UL, B460800}, {500000UL, B500000}, {921600UL, B921600}, {1000000UL, B1000000}
+  };
+
+  for(size_t i = 0 ; i < sizeof(speeds) / sizeof(speeds[0]) ; i++)
+  {
+    if(speeds[i].baud == baud)
+      return speeds[i].speed;
+  }
+
+  return B0;
+}
+
+int openHostSerial(const char *path, unsigned long baud)
+{
+  int fd = open(path, O_WRONLY | O_NOCTTY | O_CREAT | O_TRUNC, 0644);
+  struct termios tio;
+
+  if(fd < 0 || !isatty(fd))
+    return fd;
+
+  speed_t speed = speedOf(baud);
+
+  if(speed == B0 || tcgetattr(fd, &tio) != 0)
+  {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+
+  if(tcsetattr(fd, TCSANOW, &tio) != 0)
+  {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+int openPseudoTerminal(const char **slaveName)
+{
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+  if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    return -1;
+
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  struct termios tio;
+
+  if(slave < 0 || tcgetattr(slave, &tio) != 0)
+    return -1;
+
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+  fcntl(master, F_SETFL, O_NONBLOCK);
+
+  *slaveName = ptsname(master);
+
+  return master;
+}
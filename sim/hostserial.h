@@ -0,0 +1,19 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * hostserial.h : Serial ports of the host, kept apart from Arduino.h whose binary constants (B0, B110...)
+ *                clash with the baud rates of termios.h.
+ */
+
+#ifndef SIM_HOSTSERIAL_H
+#define SIM_HOSTSERIAL_H
+
+// Opens a serial port, a file or a pipe for writing ; a serial port is set to raw 8N1 at the given rate.
+// Returns -1 if it fails or if the rate is not a standard one.
+int openHostSerial(const char *path, unsigned long baud);
+
+// Opens a new pseudo-terminal and returns its master side (non-blocking), its raw slave side being kept
+// open so that writers can come and go. Returns -1 if it fails.
+int openPseudoTerminal(const char **slaveName);
+
+#endif
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Host-side simulator of the 16 * 16 LED matrix
+# ---------
+# loopback.sh : Streams the example animation to matrix-sim through a pseudo-terminal and checks that every
+#               frame got through (make loopback). FPS=0 sends as fast as the line goes, but the simulated
+#               display flushes block the loop and lose bytes, which the board does in background.
+
+SECONDS_RUN=${SECONDS_RUN:-5}
+FPS=${FPS:-200}
+OUT=obj/loopback.txt
+
+mkdir -p obj
+./matrix-sim --serial pty --realtime --seconds "$SECONDS_RUN" --render > "$OUT" &
+SIM=$!
+
+# The simulator prints the name of the pseudo-terminal first
+while ! grep -q '^serial' "$OUT" 2> /dev/null; do
+  if ! kill -0 $SIM 2> /dev/null; then
+    cat "$OUT"
+    exit 1
+  fi
+  sleep 0.1
+done
+
+DEVICE=$(sed -n 's/^serial *: //p' "$OUT")
+
+./streamsend --fps "$FPS" --loop 0 "$DEVICE" < animations/spinner.txt &
+SEND=$!
+
+wait $SIM
+STATUS=$?
+kill $SEND 2> /dev/null
+wait $SEND 2> /dev/null
+
+cat "$OUT"
+
+if [ $STATUS -ne 0 ] || ! grep -q 'stream errors *0$' "$OUT" || grep -q 'stream frames *0 ' "$OUT"; then
+  echo "loopback : FAILED"
+  exit 1
+fi
+
+echo "loopback : OK"
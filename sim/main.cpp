@@ -0,0 +1,304 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * main.cpp : Runs the firmware (setup() then loop()) on the virtual hardware and reports bus statistics.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "OneWire.h"
+#include "Wire.h"
+#include "Simulator.h"
+#include "SerialStream.h"
+#include "hostserial.h"
+#include "settings.h"
+
+#define SIM_MAX_PRESSES 64
+
+// Firmware entry points (Matrix.ino)
+void setup();
+void loop();
+
+#ifdef SERIAL_STREAM
+  extern SerialStream stream;
+#endif
+
+// Scripted button press
+struct SimPress
+{
+  uint8_t pin;
+  unsigned long start; // ms after setup()
+  unsigned long duration; // ms
+};
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+    "Usage : %s [options]\n"
+    "  --seconds N          virtual seconds to run after setup() (default 10)\n"
+    "  --loop-us N          cost of one loop() pass outside of the simulated peripherals (default 50)\n"
+    "  --pot N              potentiometer reading, 0-1023 (default 0)\n"
+    "  --light N            photocell reading, 0-1023 (default 500)\n"
+    "  --rand N             reading of the floating random seed pin (default 0)\n"
+    "  --press B@T[:D]      hold button B (mode, plus, minus) from T ms for D ms (default 100)\n"
+    "  --temp C             temperature of the sensors (default 21.5)\n"
+    "  --sensors N          number of DS18B20 on the bus (default 1)\n"
+    "  --rtc YY-MM-DD,hh:mm:ss  initial RTC time (default 12-05-01,12:00:00)\n"
+    "  --no-sqw             leave the square wave output of the RTC unconnected\n"
+    "  --eeprom FILE        load the EEPROM image from FILE and save it back on exit\n"
+    "  --serial FILE        receive the content of FILE on the serial port, at the rate set by the firmware\n"
+    "  --serial pty         receive what is written to a new pseudo-terminal (its name is printed first)\n"
+    "  --realtime           do not run faster than the wall clock (for --serial pty)\n"
+    "  --render             print the LEDs at the end of the run\n", name);
+}
+
+// Serial input : a file, or the master side of a new pseudo-terminal whose slave side is printed
+static int openSerialInput(const char *path)
+{
+  if(strcmp(path, "pty") != 0)
+    return open(path, O_RDONLY | O_NONBLOCK);
+
+  const char *name;
+  int master = openPseudoTerminal(&name);
+
+  if(master >= 0)
+  {
+    printf("serial   : %s\n", name);
+    fflush(stdout);
+  }
+
+  return master;
+}
+
+static double wallClock()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+static boolean parsePress(const char *arg, SimPress &press)
+{
+  static const char *names[3] = {"mode", "plus", "minus"};
+  static const uint8_t pins[3] = {PIN_MODE, PIN_PLUS, PIN_MINUS};
+  const char *at = strchr(arg, '@');
+
+  if(at == NULL)
+    return false;
+
+  for(int i = 0 ; i < 3 ; i++)
+  {
+    if(strncmp(arg, names[i], at - arg) == 0 && strlen(names[i]) == (size_t)(at - arg))
+    {
+      char *end;
+
+      press.pin = pins[i];
+      press.start = strtoul(at + 1, &end, 10);
+      press.duration = (*end == ':') ? strtoul(end + 1, NULL, 10) : 100UL;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+int main(int argc, char *argv[])
+{
+  Simulator &sim = simulator();
+  SimPress presses[SIM_MAX_PRESSES];
+  int pressCount = 0;
+  double seconds = 10.0;
+  unsigned long loopCost = 50UL;
+  const char *eepromPath = NULL;
+  boolean render = false;
+  boolean realtime = false;
+  boolean squareWave = true;
+  const char *serialPath = NULL;
+  float temperature = 21.5f;
+  int sensors = 1;
+  int rtc[6] = {12, 5, 1, 12, 0, 0};
+
+  sim.setAnalogInput(PIN_PHOTOCELL, 500);
+
+  for(int i = 1 ; i < argc ; i++)
+  {
+    const char *arg = argv[i];
+    const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+    if(strcmp(arg, "--render") == 0)
+    {
+      render = true;
+      continue;
+    }
+
+    if(strcmp(arg, "--realtime") == 0)
+    {
+      realtime = true;
+      continue;
+    }
+
+    if(strcmp(arg, "--no-sqw") == 0)
+    {
+      squareWave = false;
+      continue;
+    }
+
+    if(val == NULL)
+    {
+      usage(argv[0]);
+      return 1;
+    }
+
+    i++;
+
+    if(strcmp(arg, "--seconds") == 0)
+      seconds = atof(val);
+    else if(strcmp(arg, "--loop-us") == 0)
+      loopCost = strtoul(val, NULL, 10);
+    else if(strcmp(arg, "--pot") == 0)
+      sim.setAnalogInput(PIN_POT, atoi(val));
+    else if(strcmp(arg, "--light") == 0)
+      sim.setAnalogInput(PIN_PHOTOCELL, atoi(val));
+    else if(strcmp(arg, "--rand") == 0)
+      sim.setAnalogInput(PIN_RAND, atoi(val));
+    else if(strcmp(arg, "--temp") == 0)
+      temperature = (float)atof(val);
+    else if(strcmp(arg, "--sensors") == 0)
+      sensors = atoi(val);
+    else if(strcmp(arg, "--eeprom") == 0)
+      eepromPath = val;
+    else if(strcmp(arg, "--serial") == 0)
+      serialPath = val;
+    else if(strcmp(arg, "--rtc") == 0 && sscanf(val, "%d-%d-%d,%d:%d:%d", &rtc[0], &rtc[1], &rtc[2], &rtc[3], &rtc[4], &rtc[5]) == 6)
+      continue;
+    else if(strcmp(arg, "--press") == 0 && pressCount < SIM_MAX_PRESSES && parsePress(val, presses[pressCount]))
+      pressCount++;
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  simSetSensors(sensors, temperature);
+
+  // Day of week (1 = monday) from the date, Sakamoto's method
+  {
+    static const int offsets[12] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+    int y = 2000 + rtc[0] - (rtc[1] < 3);
+    int dow = (y + y / 4 - y / 100 + y / 400 + offsets[(rtc[1] - 1) % 12] + rtc[2]) % 7;
+
+    simSetRTC(rtc[0], rtc[1], rtc[2], dow == 0 ? 7 : dow, rtc[3], rtc[4], rtc[5]);
+  }
+
+  #ifdef PIN_RTC_SQW
+    if(squareWave)
+      simSetRTCSquareWavePin(PIN_RTC_SQW);
+  #endif
+
+  if(eepromPath != NULL)
+    simLoadEeprom(eepromPath);
+
+  if(serialPath != NULL)
+  {
+    int fd = openSerialInput(serialPath);
+
+    if(fd < 0)
+    {
+      perror(serialPath);
+      return 1;
+    }
+
+    simSetSerialInput(fd);
+  }
+
+  clock_t wallStart = clock();
+
+  // Boot
+  setup();
+
+  printf("setup()  : %.3f ms, %lu SPI bytes, %lu I2C transactions, %lu EEPROM reads\n",
+    sim.now() / 1000.0, sim.counters.spiBytes, sim.counters.i2cTransactions, sim.counters.eepromReads);
+
+  sim.resetCounters();
+
+  uint64_t start = sim.now();
+  uint64_t end = start + (uint64_t)(seconds * 1000000.0);
+  double realStart = wallClock();
+
+  // Main loop
+  while(sim.now() < end)
+  {
+    unsigned long elapsed = (unsigned long)((sim.now() - start) / 1000ULL);
+
+    uint8_t levels[SIM_PIN_COUNT] = {0};
+
+    for(int i = 0 ; i < pressCount ; i++)
+    {
+      if(elapsed >= presses[i].start && elapsed < presses[i].start + presses[i].duration)
+        levels[presses[i].pin] = HIGH;
+    }
+
+    // Set once per pass so that the interrupts only see real edges
+    sim.setDigitalInput(PIN_MODE, levels[PIN_MODE]);
+    sim.setDigitalInput(PIN_PLUS, levels[PIN_PLUS]);
+    sim.setDigitalInput(PIN_MINUS, levels[PIN_MINUS]);
+    simUpdateRTC();
+
+    loop();
+
+    sim.counters.loopIterations++;
+    sim.advanceMicros(loopCost);
+
+    if(realtime)
+    {
+      double ahead = (sim.now() - start) / 1000000.0 - (wallClock() - realStart);
+
+      if(ahead > 0.0)
+        usleep((useconds_t)(ahead * 1000000.0));
+    }
+  }
+
+  double wall = (double)(clock() - wallStart) / CLOCKS_PER_SEC;
+  double virt = (sim.now() - start) / 1000000.0;
+  const SimCounters &c = sim.counters;
+
+  printf("loop()   : %.3f virtual s in %.3f s (x%.0f)\n", virt, wall, wall > 0.0 ? virt / wall : 0.0);
+  printf("  iterations        %10lu  (%.1f /s)\n", c.loopIterations, c.loopIterations / virt);
+  printf("  SPI bytes         %10lu  (%.1f /s)\n", c.spiBytes, c.spiBytes / virt);
+  printf("  SPI transactions  %10lu  (%.1f /s)\n", c.spiTransactions, c.spiTransactions / virt);
+  printf("  I2C transactions  %10lu  (%.1f /s)\n", c.i2cTransactions, c.i2cTransactions / virt);
+  printf("  I2C bytes         %10lu  (%.1f /s)\n", c.i2cBytes, c.i2cBytes / virt);
+  printf("  1-Wire resets     %10lu  (%.1f /s)\n", c.oneWireResets, c.oneWireResets / virt);
+  printf("  1-Wire bytes      %10lu  (%.1f /s)\n", c.oneWireBytes, c.oneWireBytes / virt);
+  printf("  analog reads      %10lu  (%.1f /s)\n", c.analogReads, c.analogReads / virt);
+  printf("  EEPROM reads      %10lu\n", c.eepromReads);
+  printf("  EEPROM writes     %10lu\n", c.eepromWrites);
+  printf("  serial bytes      %10lu  (%.1f /s)\n", c.serialBytes, c.serialBytes / virt);
+  printf("  serial overruns   %10lu\n", c.serialOverruns);
+
+  #ifdef SERIAL_STREAM
+    printf("  stream frames     %10lu  (%.1f /s)\n", stream.getFrameCount(), stream.getFrameCount() / virt);
+    printf("  stream errors     %10u\n", stream.getErrorCount());
+  #endif
+
+  if(render)
+  {
+    printf("\n");
+    sim.render(stdout);
+  }
+
+  if(eepromPath != NULL)
+    simSaveEeprom(eepromPath);
+
+  return 0;
+}
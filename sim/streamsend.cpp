@@ -0,0 +1,245 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * streamsend.cpp : Sends text frames (see textframes.h) to the serial port of the matrix, or of matrix-sim,
+ *                  as the packets of SerialStream (see SerialStream.h) : ./streamsend DEVICE < frames.txt
+ *                  With --text, sends a text for the marquee instead : ./streamsend --text "HELLO" DEVICE
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <util/crc16.h>
+
+#include "Arduino.h"
+#include "SerialStream.h"
+#include "hostserial.h"
+#include "textframes.h"
+#include "settings.h"
+
+#define STREAMSEND_KEYFRAME_INTERVAL 10 // Frames between keyframes, so that a lost packet is not seen for long
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+    "Usage : %s [options] DEVICE < frames.txt\n"
+    "  DEVICE               serial port, file, or - for stdout\n"
+    "  --baud N             rate of the serial port, a standard one (default %lu)\n"
+    "  --fps N              frames per second, 0 = as fast as the line goes (default : durations of the frames)\n"
+    "  --loop N             times the frames are sent, 0 = forever (default 1)\n"
+    "  --keyframe N         frames between keyframes (default %d)\n"
+    "  --text TEXT          send TEXT to scroll on the marquee (%d characters at most), not frames\n", name, SERIAL_STREAM_BAUD, STREAMSEND_KEYFRAME_INTERVAL, STREAM_MAX_TEXT);
+}
+
+// Packet of a payload : header, payload, CRC
+static Bytes makePacket(uint8_t sequence, uint8_t type, const Bytes &payload)
+{
+  Bytes out;
+
+  out.push_back(STREAM_SYNC_1);
+  out.push_back(STREAM_SYNC_2);
+  out.push_back(sequence);
+  out.push_back(type);
+  out.push_back((uint8_t)(payload.size() & 0xFF));
+  out.push_back((uint8_t)(payload.size() >> 8));
+  out.insert(out.end(), payload.begin(), payload.end());
+
+  uint8_t crc = 0;
+
+  for(size_t i = 2 ; i < out.size() ; i++)
+    crc = _crc_ibutton_update(crc, out[i]);
+
+  out.push_back(crc);
+
+  return out;
+}
+
+// Packet of one frame, a keyframe or a delta from prev
+static Bytes encodePacket(uint8_t sequence, const uint8_t *prev, const uint8_t *cur)
+{
+  Bytes payload;
+  uint8_t type = ANIMATION_KEYFRAME;
+
+  if(prev != NULL)
+  {
+    payload = encodeDelta(prev, cur);
+    type = ANIMATION_DELTA;
+  }
+
+  if(prev == NULL || payload.size() >= STREAM_MAX_PAYLOAD)
+  {
+    payload.assign(cur, cur + ANIMATION_FRAME_BYTES);
+    type = ANIMATION_KEYFRAME;
+  }
+
+  return makePacket(sequence, type, payload);
+}
+
+static boolean writeAll(int fd, const Bytes &data)
+{
+  size_t done = 0;
+
+  while(done < data.size())
+  {
+    ssize_t n = write(fd, &data[done], data.size() - done);
+
+    if(n < 0 && errno != EINTR)
+      return false;
+
+    if(n > 0)
+      done += n;
+  }
+
+  return true;
+}
+
+// Sleeps until next, then moves it ms later
+static void waitUntil(struct timespec &next, long ms)
+{
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+  next.tv_nsec += ms * 1000000L;
+  next.tv_sec += next.tv_nsec / 1000000000L;
+  next.tv_nsec %= 1000000000L;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long baud = SERIAL_STREAM_BAUD;
+  long fps = -1;
+  long loops = 1;
+  long keyframeInterval = STREAMSEND_KEYFRAME_INTERVAL;
+  const char *device = NULL;
+  const char *text = NULL;
+
+  for(int i = 1 ; i < argc ; i++)
+  {
+    const char *arg = argv[i];
+    const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+    if(arg[0] != '-' || strcmp(arg, "-") == 0)
+    {
+      device = arg;
+      continue;
+    }
+
+    if(val == NULL)
+    {
+      usage(argv[0]);
+      return 1;
+    }
+
+    i++;
+
+    if(strcmp(arg, "--baud") == 0)
+      baud = strtoul(val, NULL, 10);
+    else if(strcmp(arg, "--fps") == 0)
+      fps = atol(val);
+    else if(strcmp(arg, "--loop") == 0)
+      loops = atol(val);
+    else if(strcmp(arg, "--keyframe") == 0)
+      keyframeInterval = atol(val);
+    else if(strcmp(arg, "--text") == 0)
+      text = val;
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<TextFrame> frames;
+
+  if(device == NULL || baud == 0UL || keyframeInterval < 1)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if(text != NULL && strlen(text) > STREAM_MAX_TEXT)
+  {
+    fprintf(stderr, "text longer than %d characters\n", STREAM_MAX_TEXT);
+    return 1;
+  }
+
+  if(text == NULL && !readTextFrames(stdin, frames))
+    return 1;
+
+  if(text == NULL && frames.empty())
+  {
+    fprintf(stderr, "no frames\n");
+    return 1;
+  }
+
+  int fd = strcmp(device, "-") == 0 ? STDOUT_FILENO : openHostSerial(device, baud);
+
+  if(fd < 0)
+  {
+    perror(device);
+    return 1;
+  }
+
+  if(text != NULL)
+  {
+    Bytes packet = makePacket(0, STREAM_TEXT, Bytes(text, text + strlen(text)));
+
+    if(!writeAll(fd, packet))
+    {
+      perror(device);
+      return 1;
+    }
+
+    if(fd != STDOUT_FILENO)
+      close(fd);
+
+    fprintf(stderr, "text, %lu bytes\n", (unsigned long)packet.size());
+
+    return 0;
+  }
+
+  struct timespec start, next;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  next = start;
+
+  unsigned long count = 0UL, keyframes = 0UL, bytes = 0UL;
+  const uint8_t *prev = NULL;
+
+  for(long loop = 0 ; loops == 0 || loop < loops ; loop++)
+  {
+    for(size_t i = 0 ; i < frames.size() ; i++)
+    {
+      Bytes packet = encodePacket((uint8_t)count, count % keyframeInterval == 0 ? NULL : prev, frames[i].bits);
+
+      if(packet[3] == ANIMATION_KEYFRAME)
+        keyframes++;
+
+      if(fps != 0)
+        waitUntil(next, fps > 0 ? 1000L / fps : frames[i].duration);
+
+      if(!writeAll(fd, packet))
+      {
+        perror(device);
+        return 1;
+      }
+
+      prev = frames[i].bits;
+      bytes += packet.size();
+      count++;
+    }
+  }
+
+  if(fd != STDOUT_FILENO)
+    close(fd); // Waits for a serial port to send everything
+
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  fprintf(stderr, "%lu frames (%lu keyframes), %lu bytes in %.3f s : %.1f bytes per frame, %.0f frames/s at most at %lu baud\n",
+    count, keyframes, bytes, wall, (double)bytes / count, baud / 10.0 / ((double)bytes / count), baud);
+
+  return 0;
+}
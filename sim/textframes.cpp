@@ -0,0 +1,114 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * textframes.cpp : Reads text frames and encodes the differences between frames.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "textframes.h"
+#include "settings.h"
+
+boolean readTextFrames(FILE *in, std::vector<TextFrame> &frames)
+{
+  TextFrame cur;
+  int rows = 0, lineNumber = 0;
+  char line[256];
+
+  memset(cur.bits, 0, sizeof(cur.bits));
+  cur.duration = TEXTFRAMES_DEFAULT_DURATION;
+
+  while(true)
+  {
+    boolean end = fgets(line, sizeof(line), in) == NULL;
+    lineNumber++;
+
+    if(!end && line[0] == ';')
+      continue;
+
+    if(!end && line[0] == '@')
+    {
+      cur.duration = atoi(line + 1);
+
+      if(cur.duration < 0 || cur.duration > 32767)
+      {
+        fprintf(stderr, "line %d : duration out of 0-32767\n", lineNumber);
+        return false;
+      }
+
+      continue;
+    }
+
+    int x = 0;
+
+    for(const char *c = end ? "" : line ; *c != '\0' && *c != '\n' && *c != '\r' ; c++)
+    {
+      if(*c == ' ' || *c == '\t')
+        continue;
+
+      if(x < DISPLAY_WIDTH && rows < DISPLAY_HEIGHT && (*c == 'X' || *c == '#'))
+        cur.bits[rows * DISPLAY_BLOCKS_X + x / 8] |= 0x80 >> (x % 8);
+
+      x++;
+    }
+
+    if(x > 0) // Row of LEDs
+    {
+      if(x != DISPLAY_WIDTH || rows == DISPLAY_HEIGHT)
+      {
+        fprintf(stderr, "line %d : frames are %d x %d LEDs\n", lineNumber, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        return false;
+      }
+
+      rows++;
+    }
+    else if(rows > 0) // End of a frame
+    {
+      if(rows != DISPLAY_HEIGHT)
+      {
+        fprintf(stderr, "line %d : frames are %d x %d LEDs\n", lineNumber, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        return false;
+      }
+
+      frames.push_back(cur);
+      memset(cur.bits, 0, sizeof(cur.bits));
+      rows = 0;
+    }
+
+    if(end)
+      return true;
+  }
+}
+
+Bytes encodeDelta(const uint8_t *prev, const uint8_t *cur)
+{
+  Bytes out;
+  int i = 0;
+
+  while(i < ANIMATION_FRAME_BYTES)
+  {
+    int start = i;
+
+    if(prev[i] == cur[i])
+    {
+      while(i < ANIMATION_FRAME_BYTES && i - start < TEXTFRAMES_MAX_RUN && prev[i] == cur[i])
+        i++;
+
+      out.push_back((uint8_t)(i - start - 1));
+      continue;
+    }
+
+    // A single unchanged byte between changes is cheaper inside the XOR run
+    while(i < ANIMATION_FRAME_BYTES && i - start < TEXTFRAMES_MAX_RUN &&
+      (prev[i] != cur[i] || (i + 1 < ANIMATION_FRAME_BYTES && prev[i + 1] != cur[i + 1])))
+      i++;
+
+    out.push_back((uint8_t)(ANIMATION_RUN_XOR | (i - start - 1)));
+
+    for(int j = start ; j < i ; j++)
+      out.push_back(prev[j] ^ cur[j]);
+  }
+
+  return out;
+}
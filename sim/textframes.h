@@ -0,0 +1,36 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * textframes.h : Text frames and delta encoding shared by animconv and streamsend.
+ *
+ * Text frames : one line per row of LEDs ('X' or '#' lit, '.' off, spaces ignored), frames separated by blank
+ * lines, '@N' sets the duration (ms) of the next frames (default 100), ';' starts a comment line.
+ */
+
+#ifndef SIM_TEXTFRAMES_H
+#define SIM_TEXTFRAMES_H
+
+#include <stdio.h>
+#include <vector>
+
+#include "Arduino.h"
+#include "Animation.h"
+
+#define TEXTFRAMES_DEFAULT_DURATION 100
+#define TEXTFRAMES_MAX_RUN 128
+
+typedef std::vector<uint8_t> Bytes;
+
+struct TextFrame
+{
+  uint8_t bits[ANIMATION_FRAME_BYTES]; // Rows from the top, 8 LEDs per byte (MSB = leftmost LED)
+  int duration; // ms
+};
+
+// Reads every frame of the file, prints the line of the first error on stderr
+boolean readTextFrames(FILE *in, std::vector<TextFrame> &frames);
+
+// Runs of unchanged bytes and XOR bytes turning prev into cur (see Animation.h)
+Bytes encodeDelta(const uint8_t *prev, const uint8_t *cur);
+
+#endif
@@ -0,0 +1,23 @@
+/*
+ * Host-side simulator of the 16 * 16 LED matrix
+ * ---------
+ * util/crc16.h : Stand-in for the CRC helpers of avr-libc.
+ */
+
+#ifndef SIM_UTIL_CRC16_H
+#define SIM_UTIL_CRC16_H
+
+#include <stdint.h>
+
+// CRC-8 of the Dallas/Maxim 1-Wire devices (polynomial x^8 + x^5 + x^4 + 1, reflected)
+static inline uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data)
+{
+  crc ^= data;
+
+  for(int i = 0 ; i < 8 ; i++)
+    crc = (crc & 0x01) ? (crc >> 1) ^ 0x8C : crc >> 1;
+
+  return crc;
+}
+
+#endif